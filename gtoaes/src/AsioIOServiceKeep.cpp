@@ -5,6 +5,7 @@
  * @author Xiaomeng Lu
  */
 
+#include <time.h>
 #include <boost/bind/bind.hpp>
 #include "AsioIOServiceKeep.h"
 
@@ -23,3 +24,66 @@ AsioIOServiceKeep::~AsioIOServiceKeep() {
 AsioIOServiceKeep::IOService& AsioIOServiceKeep::GetIOService() {
 	return ios_;
 }
+
+/////////////////////////////////////////////////////////////////////
+AsioIOServicePool::AsioIOServicePool() {
+	next_ = 0;
+}
+
+AsioIOServicePool::~AsioIOServicePool() {
+	Stop();
+}
+
+AsioIOServicePool& AsioIOServicePool::Instance() {
+	static AsioIOServicePool pool;
+	return pool;
+}
+
+bool AsioIOServicePool::Start(int n) {
+	MtxLck lck(mtx_);
+	if (ios_.empty()) create_services(n);
+	return true;
+}
+
+void AsioIOServicePool::create_services(int n) {
+	if (n <= 0 && (n = boost::thread::hardware_concurrency()) <= 0) n = 1;
+	for (int i = 0; i < n; ++i) {
+		IOSPtr ios(new IOService(1));
+		ios_.push_back(ios);
+		work_.push_back(WorkPtr(new Work(*ios)));
+		thrds_.create_thread(boost::bind(&IOService::run, ios.get()));
+	}
+}
+
+void AsioIOServicePool::Stop() {
+	MtxLck lck(mtx_);
+	work_.clear();
+	for (IOSVec::iterator it = ios_.begin(); it != ios_.end(); ++it)
+		(*it)->stop();
+	thrds_.join_all();
+}
+
+int AsioIOServicePool::Size() {
+	MtxLck lck(mtx_);
+	return ios_.size();
+}
+
+AsioIOServicePool::IOService& AsioIOServicePool::GetIOService() {
+	MtxLck lck(mtx_);
+	if (ios_.empty()) create_services(0);
+	IOService& ios = *ios_[next_];
+	if (++next_ == ios_.size()) next_ = 0;
+	return ios;
+}
+
+AsioIOServicePool::IOService& AsioIOServicePool::GetIOService(unsigned int index) {
+	MtxLck lck(mtx_);
+	if (ios_.empty()) create_services(0);
+	return *ios_[index % ios_.size()];
+}
+
+int64_t AsioIOServicePool::RealTime() {
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
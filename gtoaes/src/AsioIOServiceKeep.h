@@ -6,13 +6,24 @@
  * @note
  * @li boost::asio::io_service::run()在响应所注册的异步调用后自动退出. 为了避免退出run()函数,
  * 建立ioservice_keep维护其长期有效性
+ * @version 0.2
+ * @date 2026-10-16
+ * @note
+ * @li 新增AsioIOServicePool: 进程内共享的io_service线程池. 网络连接按轮询方式绑定到池中的
+ * io_service, 线程数量不随连接数量增长
+ * @li 可按索引分配io_service, 将一组对象确定地分布在不同线程上
+ * @li 新增RealTime(): TCP与UDP连接共用的数据到达时间
  */
 
 #ifndef SRC_ASIOIOSERVICEKEEP_H_
 #define SRC_ASIOIOSERVICEKEEP_H_
 
+#include <vector>
+#include <stdint.h>
 #include <boost/asio/io_service.hpp>
 #include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/smart_ptr/shared_ptr.hpp>
 
 class AsioIOServiceKeep {
 public:
@@ -34,4 +45,90 @@ protected:
 	void thread_keep();
 };
 
+/*!
+ * @class AsioIOServicePool
+ * @brief 进程内共享的io_service池
+ * @note
+ * - 每个io_service由一个线程执行run(), 绑定到同一io_service的套接口其回调函数串行执行
+ * - 套接口创建时按轮询方式选择io_service
+ * - 首次调用GetIOService()时若未启动, 则按缺省线程数启动
+ */
+class AsioIOServicePool {
+public:
+	using IOService = boost::asio::io_service;
+
+protected:
+	using Work = IOService::work;
+	using IOSPtr = boost::shared_ptr<IOService>;
+	using WorkPtr = boost::shared_ptr<Work>;
+	using IOSVec = std::vector<IOSPtr>;
+	using WorkVec = std::vector<WorkPtr>;
+	using MtxLck = boost::unique_lock<boost::mutex>;
+
+protected:
+	/* 成员变量 */
+	IOSVec ios_;		///< io_service集合
+	WorkVec work_;		///< 维持io_service::run()
+	boost::thread_group thrds_;	///< 执行io_service::run()的线程
+	unsigned int next_;	///< 下一个被分配的io_service索引
+	boost::mutex mtx_;	///< 互斥锁
+
+protected:
+	AsioIOServicePool();
+
+public:
+	virtual ~AsioIOServicePool();
+	/*!
+	 * @brief 访问进程内唯一实例
+	 * @return
+	 * io_service池
+	 */
+	static AsioIOServicePool& Instance();
+	/*!
+	 * @brief 创建io_service并启动线程
+	 * @param n  线程数量. n <= 0时使用CPU核数
+	 * @return
+	 * 启动结果
+	 */
+	bool Start(int n = 0);
+	/*!
+	 * @brief 停止所有io_service并等待线程退出
+	 */
+	void Stop();
+	/*!
+	 * @brief 查看线程数量
+	 * @return
+	 * 线程数量
+	 */
+	int Size();
+	/*!
+	 * @brief 按轮询方式分配io_service
+	 * @return
+	 * io_service对象
+	 */
+	IOService& GetIOService();
+	/*!
+	 * @brief 按索引分配io_service
+	 * @param index  索引. 按线程数量取模
+	 * @return
+	 * io_service对象
+	 * @note
+	 * 不影响GetIOService()的轮询位置. 用于将一组对象确定地分布在不同线程上
+	 */
+	IOService& GetIOService(unsigned int index);
+	/*!
+	 * @brief 查看当前UTC时间. I/O线程以此标记数据到达时间
+	 * @return
+	 * 自1970-01-01起的纳秒数
+	 */
+	static int64_t RealTime();
+
+protected:
+	/*!
+	 * @brief 创建io_service并启动线程. 调用者持有互斥锁
+	 * @param n  线程数量
+	 */
+	void create_services(int n);
+};
+
 #endif /* SRC_ASIOIOSERVICEKEEP_H_ */
@@ -5,47 +5,77 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/bind/bind.hpp>
 #include <boost/asio/buffer.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/make_shared.hpp>
 #include <boost/asio/placeholders.hpp>
+#include <boost/system/system_error.hpp>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
 #include "AsioTCP.h"
 
 using namespace boost::system;
 using namespace boost::placeholders;
 using namespace boost::asio;
 using std::string;
+using boost::chrono::microseconds;
+using boost::chrono::milliseconds;
+using boost::chrono::duration_cast;
+
+/*!
+ * @brief 时间点换算为微秒. 用于计算往返时间
+ */
+static int64_t steady_us(const TcpClient::SteadyClock::time_point& tm) {
+	return duration_cast<microseconds>(tm.time_since_epoch()).count();
+}
 
 /////////////////////////////////////////////////////////////////////
 /*--------------------- 客户端 ---------------------*/
 TcpClient::TcpClient(bool modeAsync)
-	: sock_(keep_.GetIOService()) {
+	: ios_(AsioIOServicePool::Instance().GetIOService())
+	, sock_(ios_)
+	, netbuf_read_(modeAsync ? TCP_READ_MAX : 0, TCP_READ_INIT) {
 	mode_async_ = modeAsync;
 	byte_read_  = 0;
-	buf_read_.reset(new char[TCP_PACK_SIZE]);
-	if (mode_async_) {
-		crcbuf_read_.set_capacity(TCP_PACK_SIZE * 50);
-		crcbuf_write_.set_capacity(TCP_PACK_SIZE * 50);
-	}
+	byte_write_ = 0;
+	cork_       = 0;
+	bytes_in_   = 0;
+	msg_in_     = 0;
+	trace_rtt_  = false;
+	tm_request_ = 0;
+	stamp_kernel_ = false;
+	tm_arrival_ = tm_batch_ = 0;
+#ifdef USE_IO_URING
+	uring_key_  = 0;
+#endif
+	if (mode_async_) netbuf_read_.SetMaxLine(TCP_LINE_MAX);
+	else buf_read_.reset(new char[TCP_PACK_SIZE]);
 }
 
 TcpClient::~TcpClient() {
 
 }
 
-TcpClient::TCP::socket& TcpClient::Socket() {
+TcpClient::Stream::socket& TcpClient::Socket() {
 	return sock_;
 }
 
 bool TcpClient::Connect(const std::string& host, const uint16_t port) {
 	try {
-		TCP::resolver rslv(keep_.GetIOService());
+		TCP::resolver rslv(ios_);
 		TCP::resolver::query query(host, boost::lexical_cast<string>(port));
 		TCP::resolver::iterator itertor = rslv.resolve(query);
+		Stream::endpoint endpt(itertor->endpoint());
 
 		if (mode_async_) {
-			sock_.async_connect(*itertor,
-					boost::bind(&TcpClient::handle_connect, this, placeholders::error));
+			sock_.async_connect(endpt,
+					boost::bind(&TcpClient::handle_connect, shared_from_this(), placeholders::error));
 		}
 		else {
-			sock_.connect(*itertor);
+			sock_.connect(endpt);
 			sock_.set_option(socket_base::keep_alive(true));
 			start_read();
 		}
@@ -58,8 +88,8 @@ bool TcpClient::Connect(const std::string& host, const uint16_t port) {
 
 bool TcpClient::ShutDown(int how) {
 	try {
-		sock_.shutdown(how == 0 ? TCP::socket::shutdown_receive
-				: (how == 1 ? TCP::socket::shutdown_send : TCP::socket::shutdown_both));
+		sock_.shutdown(how == 0 ? Stream::socket::shutdown_receive
+				: (how == 1 ? Stream::socket::shutdown_send : Stream::socket::shutdown_both));
 		return true;
 	}
 	catch(std::exception& ex) {
@@ -68,6 +98,11 @@ bool TcpClient::ShutDown(int how) {
 }
 
 bool TcpClient::Close() {
+#ifdef USE_IO_URING
+	// io_uring接收持有套接口引用: 取消后套接口才真正关闭
+	uint64_t key = uring_key_;
+	if (key) boost::asio::use_service<IoUringService>(ios_).Cancel(key);
+#endif
 	try {
 		if (sock_.is_open()) sock_.close();
 		return true;
@@ -86,48 +121,221 @@ int TcpClient::Read(char* data, const int n, const int from) {
 		return 0;
 
 	MtxLck lck(mtx_read_);
+	if (mode_async_) return netbuf_read_.Read(data, n, from);
+
 	int end(from + n), to_read;
-	if (mode_async_) {
-		to_read = crcbuf_read_.size() > end ? n : crcbuf_read_.size() - from;
-		if (to_read) {
-			int i, j;
-			for (i = 0, j = from; i < to_read; ++i, ++j)
-				data[i] = crcbuf_read_[j];
-			crcbuf_read_.erase_begin(end);
-		}
-	}
-	else {
-		to_read = byte_read_ > end ? n : byte_read_ - from;
-		if (to_read) {
-			memcpy(data, buf_read_.get() + from, to_read);
-			byte_read_ -= end;
-		}
+	to_read = byte_read_ > end ? n : byte_read_ - from;
+	if (to_read) {
+		memcpy(data, buf_read_.get() + from, to_read);
+		byte_read_ -= end;
 	}
 	return to_read;
 }
 
-int TcpClient::Write(const char* data, const int n) {
+char* TcpClient::ReadLine(int& n) {
+	n = 0;
+	if (!mode_async_) return NULL;
+	MtxLck lck(mtx_read_);
+	char* line = netbuf_read_.ReadLine(n);
+	if (line) count_lines(1);
+	return line;
+}
+
+int TcpClient::ExtractLines(NetBuffer::LineVec& lines) {
+	lines.clear();
+	if (!mode_async_) return 0;
+	MtxLck lck(mtx_read_);
+	int n = netbuf_read_.ExtractLines(lines);
+	count_lines(n);
+	return n;
+}
+
+int TcpClient::Write(const char* data, const int n, const int type, const string& key) {
 	if (!data || n <= 0)
 		return 0;
 
+	if (mode_async_) return Write(CreateMessage(data, n), type, key);
+
 	MtxLck lck(mtx_write_);
-	int had_write(n);
-	if (!mode_async_) had_write = sock_.write_some(buffer(data, n));
-	else {
-		int wait_write(crcbuf_write_.size());
-		for (int i = 0; i < n; ++i)
-			crcbuf_write_.push_back(data[i]);
-		if (!wait_write)
-			start_write();
+	int sent = sock_.write_some(buffer(data, n));
+	stat_.bytesOut += sent;
+	++stat_.msgOut;
+	return sent;
+}
+
+int TcpClient::Write(const TcpMsgPtr msg, const int type, const string& key) {
+	int n = msg.use_count() ? msg->size() : 0;
+	if (!n || !mode_async_)
+		return 0;
+
+	MtxLck lck(mtx_write_);
+	int64_t request = tm_request_;	// 收到信息后的第一条发送信息视为其应答
+	tm_request_ = 0;
+	if (type == TCPMSG_STATUS && !key.empty()) {// 替换未发送的同键值状态信息
+		for (MsgQue::iterator it = que_write_.begin(); it != que_write_.end(); ++it) {
+			if (it->type == type && it->key == key) {
+				int old = it->msg->size();
+				++stat_.msgCoalesced;
+				stat_.bytesCoalesced += old;
+				byte_write_ += n - old;
+				if (byte_write_ > stat_.depthMax) stat_.depthMax = byte_write_;
+				it->msg = msg;
+				if (!it->request) it->request = request;
+				return n;
+			}
+		}
+	}
+	if (type != TCPMSG_COMMAND && byte_write_ + n > TCP_WRITE_MAX) {// 队列已满
+		++stat_.msgDropped;
+		stat_.bytesDropped += n;
+		return 0;
+	}
+	que_write_.push_back(Outgoing(msg, type, key, request));
+	byte_write_ += n;
+	if (byte_write_ > stat_.depthMax) stat_.depthMax = byte_write_;
+	if (!cork_ && msg_writing_.empty())
+		start_write();
+	return n;
+}
+
+void TcpClient::SetMaxLine(int n) {
+	if (n <= 0 || n > TCP_LINE_MAX) n = TCP_LINE_MAX;
+	MtxLck lck(mtx_read_);
+	netbuf_read_.SetMaxLine(n);
+}
+
+void TcpClient::ReleaseLines() {
+	MtxLck lck(mtx_read_);
+	netbuf_read_.Release();
+}
+
+bool TcpClient::ShrinkBuffer() {
+	MtxLck lck(mtx_read_);
+	return netbuf_read_.Trim();
+}
+
+int TcpClient::IdleTime() {
+	MtxLck lck(mtx_read_);
+	return boost::chrono::duration_cast<boost::chrono::milliseconds>(SteadyClock::now() - tm_active_).count();
+}
+
+bool TcpClient::Probe(int interval, int count) {
+#if defined(TCP_KEEPIDLE) && defined(TCP_KEEPINTVL) && defined(TCP_KEEPCNT)
+	using namespace boost::asio::detail::socket_option;
+	error_code ec;
+	if (interval < 1) interval = 1;
+	if (count < 1) count = 1;
+	sock_.set_option(socket_base::keep_alive(true), ec);
+	if (!ec) sock_.set_option(integer<IPPROTO_TCP, TCP_KEEPIDLE>(interval), ec);
+	if (!ec) sock_.set_option(integer<IPPROTO_TCP, TCP_KEEPINTVL>(interval), ec);
+	if (!ec) sock_.set_option(integer<IPPROTO_TCP, TCP_KEEPCNT>(count), ec);
+	return !ec;
+#else
+	return false;
+#endif
+}
+
+int TcpClient::MemoryUsage() {
+	int n(sizeof(TcpClient));
+	if (buf_read_.get()) n += TCP_PACK_SIZE;
+	{
+		MtxLck lck(mtx_read_);
+		n += netbuf_read_.Memory();
+	}
+	{
+		MtxLck lck(mtx_write_);
+		n += byte_write_;
+	}
+	return n;
+}
+
+bool TcpClient::CheckOverflow(NetReadStat& stat) {
+	MtxLck lck(mtx_read_);
+	return netbuf_read_.CheckOverflow(stat);
+}
+
+TcpWriteStat TcpClient::GetWriteStat() {
+	MtxLck lck(mtx_write_);
+	return stat_;
+}
+
+TcpStat TcpClient::GetStat() {
+	TcpStat stat;
+	uint64_t bytesIn, msgIn;
+	{
+		MtxLck lck(mtx_read_);
+		bytesIn = bytes_in_;
+		msgIn   = msg_in_;
+	}
+	{
+		MtxLck lck(mtx_write_);
+		stat = stat_;
+		stat.depth    = byte_write_;
+		stat.depthMsg = que_write_.size() + msg_writing_.size();
+		if (!msg_writing_.empty())
+			stat.blockedMs = duration_cast<milliseconds>(SteadyClock::now() - tm_write_).count();
 	}
+	stat.bytesIn = bytesIn;
+	stat.msgIn   = msgIn;
+	return stat;
+}
+
+string TcpClient::PeerName() {
+	error_code ec;
+	Stream::endpoint endpt = sock_.remote_endpoint(ec);
+	if (ec) return "";
+	int family = endpt.protocol().family();
+	if (family != AF_INET && family != AF_INET6) return "local";
+
+	TCP::endpoint tcp;
+	memcpy(tcp.data(), endpt.data(), endpt.size());
+	tcp.resize(endpt.size());
+	return tcp.address().to_string() + ":" + boost::lexical_cast<string>(tcp.port());
+}
+
+bool TcpClient::EnableTimestamp(bool enable) {
+#ifdef SO_TIMESTAMPNS
+	using namespace boost::asio::detail::socket_option;
+	error_code ec;
+	sock_.set_option(boolean<SOL_SOCKET, SO_TIMESTAMPNS>(enable), ec);
+	if (ec) return false;
+	MtxLck lck(mtx_read_);
+	stamp_kernel_ = enable;
+	return true;
+#else
+	return false;
+#endif
+}
+
+int64_t TcpClient::RealTime() {
+	return AsioIOServicePool::RealTime();
+}
+
+void TcpClient::TraceRoundTrip(bool enable) {
+	MtxLck lck(mtx_write_);
+	trace_rtt_  = enable;
+	tm_request_ = 0;
+}
 
-	return had_write;
+TcpMsgPtr TcpClient::CreateMessage(const char* data, const int n) {
+	return boost::make_shared<const string>(data, n);
+}
+
+void TcpClient::Cork() {
+	MtxLck lck(mtx_write_);
+	++cork_;
+}
+
+void TcpClient::Uncork() {
+	MtxLck lck(mtx_write_);
+	if (cork_ > 0 && --cork_ == 0 && msg_writing_.empty())
+		start_write();
 }
 
 int TcpClient::Lookup(char* first) {
 	MtxLck lck(mtx_read_);
-	int n = mode_async_ ? crcbuf_read_.size() : byte_read_;
-	if (first && n) *first = mode_async_ ? crcbuf_read_[0] : buf_read_[0];
+	int n = mode_async_ ? netbuf_read_.Size() : byte_read_;
+	if (first && n) *first = mode_async_ ? netbuf_read_.Data()[0] : buf_read_[0];
 	return n;
 }
 
@@ -136,138 +344,597 @@ int TcpClient::Lookup(const char* flag, const int n, const int from) {
 		return -1;
 
 	MtxLck lck(mtx_read_);
-	int end = (mode_async_ ? crcbuf_read_.size() : byte_read_) - n;
-	int pos, i(0), j;
+	if (mode_async_) return netbuf_read_.Find(flag, n, from);
 
-	if (mode_async_) {
-		for (pos = from; pos <= end; ++pos) {
-			for (i = 0, j = pos; i < n && flag[i] == crcbuf_read_[j]; ++i, ++j);
-			if (i == n) break;
-		}
-	}
-	else {
-		for (pos = from; pos <= end; ++pos) {
-			for (i = 0, j = pos; i < n && flag[i] == buf_read_[j]; ++i, ++j);
-			if (i == n) break;
-		}
+	int end = byte_read_ - n;
+	int pos, i(0), j;
+	for (pos = from; pos <= end; ++pos) {
+		for (i = 0, j = pos; i < n && flag[i] == buf_read_[j]; ++i, ++j);
+		if (i == n) break;
 	}
 
 	return (i == n ? pos : -1);
 }
 
 void TcpClient::Start() {
-	sock_.set_option(socket_base::keep_alive(true));
+	{
+		MtxLck lck(mtx_read_);
+		tm_active_ = SteadyClock::now();
+	}
+	error_code ec;
+	sock_.set_option(socket_base::keep_alive(true), ec);	// 本地套接口不使用
+	if (mode_async_) sock_.non_blocking(true);
 	start_read();
 }
 
 void TcpClient::RegisterConnect(const CBSlot& slot) {
-	cbconn_.disconnect_all_slots();
-	cbconn_.connect(slot);
+	cbconn_ = slot;
 }
 
 void TcpClient::RegisterRead(const CBSlot& slot) {
-	cbread_.disconnect_all_slots();
-	cbread_.connect(slot);
+	MtxLck lck(mtx_cb_);
+	cbread_ = slot;
 }
 
 void TcpClient::RegisterWrite(const CBSlot& slot) {
-	cbwrite_.disconnect_all_slots();
-	cbwrite_.connect(slot);
+	cbwrite_ = slot;
+}
+
+void TcpClient::RegisterLine(const LineFunc& slot) {
+	MtxLck lck(mtx_cb_);
+	cbline_ = slot;
 }
 
 void TcpClient::start_read() {
-	if (sock_.is_open()) {
+	if (!sock_.is_open()) return;
+	if (mode_async_) {// 数据到达后再准备接收缓冲区, 空闲连接不占用存储区
+#ifdef USE_IO_URING
+		IoUringService& uring = boost::asio::use_service<IoUringService>(ios_);
+		if (uring.IsValid()) {
+			uring_key_ = uring.Receive(sock_.native_handle(),
+					boost::bind(&TcpClient::handle_uring, shared_from_this(), _1, _2));
+			return;
+		}
+#endif
+		ReadLoop loop(shared_from_this());
+		loop();
+	}
+	else {
 		sock_.async_read_some(buffer(buf_read_.get(), TCP_PACK_SIZE),
-				boost::bind(&TcpClient::handle_read, this,
+				boost::bind(&TcpClient::handle_read, shared_from_this(),
 					placeholders::error, placeholders::bytes_transferred));
 	}
 }
 
 void TcpClient::start_write() {
-	int towrite(crcbuf_write_.size());
-	if (towrite) {
-		sock_.async_write_some(buffer(crcbuf_write_.linearize(), towrite),
-				boost::bind(&TcpClient::handle_write, this,
-					placeholders::error, placeholders::bytes_transferred));
+	if (que_write_.empty() || !sock_.is_open()) return;
+
+	std::vector<const_buffer> bufs;
+	while (!que_write_.empty() && msg_writing_.size() < TCP_GATHER_MAX) {
+		msg_writing_.push_back(que_write_.front());
+		que_write_.pop_front();
+		const TcpMsgPtr& msg = msg_writing_.back().msg;
+		bufs.push_back(buffer(msg->data(), msg->size()));
 	}
+	tm_write_ = SteadyClock::now();
+	async_write(sock_, bufs,
+			boost::bind(&TcpClient::handle_write, shared_from_this(),
+				placeholders::error, placeholders::bytes_transferred));
 }
 
 /* 响应async_函数的回调函数 */
 void TcpClient::handle_connect(const error_code& ec) {
 	cbconn_(shared_from_this(), ec);
 	if (!ec) {
+		{
+			MtxLck lck(mtx_read_);
+			tm_active_ = SteadyClock::now();
+		}
 		sock_.set_option(socket_base::keep_alive(true));
+		sock_.non_blocking(true);
 		start_read();
 	}
 }
 
+#include <boost/asio/yield.hpp>
+void TcpClient::ReadLoop::operator()(const error_code& ec) {
+	TcpClient* self = client.get();
+	error_code ec1(ec);
+	int n;
+
+	reenter (this) {
+		while (!ec1) {
+			yield self->sock_.async_wait(Stream::socket::wait_read, *this);
+			n = ec1 ? 0 : self->read_available(ec1);
+			if (n) {// 先处理已读出数据, 再处理错误
+				self->dispatch_lines();
+			}
+		}
+		// 连接断开或出错
+		self->notify_read(ec1);
+	}
+}
+#include <boost/asio/unyield.hpp>
+
+int TcpClient::read_available(error_code& ec) {
+	MtxLck lck(mtx_read_);
+	int total(0), n(TCP_PACK_SIZE);
+	int64_t stamp(0), ts(0);
+
+	// 直接写入接收缓冲区尾部. 未读满时套接口中已无数据
+	for (int i = 0; i < TCP_READ_BURST && n == TCP_PACK_SIZE; ++i) {
+		char* data = netbuf_read_.Prepare(TCP_PACK_SIZE);
+		if (stamp_kernel_) n = read_stamped(data, TCP_PACK_SIZE, ts, ec);
+		else n = sock_.read_some(buffer(data, TCP_PACK_SIZE), ec);
+		if (ec) break;
+		netbuf_read_.Commit(n);
+		total += n;
+		if (!stamp) stamp = ts;	// 本次唤醒最早到达的数据
+	}
+	if (ec == error::would_block || ec == error::try_again) ec.clear();
+	if (total) {
+		tm_active_  = SteadyClock::now();
+		tm_arrival_ = stamp ? stamp : RealTime();
+		bytes_in_ += total;
+	}
+	return total;
+}
+
+int TcpClient::read_stamped(char* data, int n, int64_t& stamp, error_code& ec) {
+	char control[CMSG_SPACE(sizeof(struct timespec))];
+	struct iovec iov;
+	struct msghdr msg;
+	ssize_t rslt;
+
+	iov.iov_base = data;
+	iov.iov_len  = n;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov        = &iov;
+	msg.msg_iovlen     = 1;
+	msg.msg_control    = control;
+	msg.msg_controllen = sizeof(control);
+	do {
+		rslt = ::recvmsg(sock_.native_handle(), &msg, 0);
+	} while (rslt < 0 && errno == EINTR);
+	if (rslt < 0) {
+		ec = error_code(errno, system_category());
+		return 0;
+	}
+	if (rslt == 0) {
+		ec = error::eof;
+		return 0;
+	}
+#ifdef SO_TIMESTAMPNS
+	for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+			struct timespec ts;
+			memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+			stamp = int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+		}
+	}
+#endif
+	return rslt;
+}
+
+void TcpClient::dispatch_lines() {
+	LineFunc cb;
+	{// 拷贝后调用: 处理函数可在连接工作时被替换
+		MtxLck lck(mtx_cb_);
+		cb = cbline_;
+	}
+	if (!cb) {
+		notify_read(error_code());
+		return;
+	}
+
+	{
+		MtxLck lck(mtx_read_);
+		netbuf_read_.ExtractLines(lines_);
+		count_lines(lines_.size());
+		tm_batch_ = tm_arrival_;
+	}
+	if (lines_.empty()) return;
+
+	Pointer self = shared_from_this();
+	Cork();	// 对同一批信息的回复合并发送
+	for (NetBuffer::LineVec::iterator it = lines_.begin(); it != lines_.end() && sock_.is_open(); ++it)
+		cb(self, it->first, it->second);
+	ReleaseLines();
+	Uncork();
+}
+
+void TcpClient::notify_read(const error_code& ec) {
+	CallbackFunc cb;
+	{// 拷贝后调用: 回调函数中可以替换回调函数
+		MtxLck lck(mtx_cb_);
+		cb = cbread_;
+	}
+	cb(shared_from_this(), ec);
+}
+
+void TcpClient::count_lines(int n) {
+	if (!n) return;
+	msg_in_ += n;
+	MtxLck lck(mtx_write_);
+	if (trace_rtt_ && !tm_request_) tm_request_ = steady_us(tm_active_);
+}
+
+#ifdef USE_IO_URING
+void TcpClient::handle_uring(const char* data, int n) {
+	if (n > 0) {
+		{
+			MtxLck lck(mtx_read_);
+			memcpy(netbuf_read_.Prepare(n), data, n);
+			netbuf_read_.Commit(n);
+			tm_active_  = SteadyClock::now();
+			tm_arrival_ = RealTime();	// multishot接收不携带控制信息
+			bytes_in_ += n;
+		}
+		dispatch_lines();
+	}
+	else {// 接收结束
+		uring_key_ = 0;
+		if (n == -EINVAL && sock_.is_open()) {// 内核不支持multishot recv: 数据未被读出, 改用epoll接收
+			ReadLoop loop(shared_from_this());
+			loop();
+		}
+		else notify_read(n ? error_code(-n, system_category()) : error_code(error::eof));
+	}
+}
+#endif
+
 void TcpClient::handle_read(const error_code& ec, int n) {
 	if (!ec) {
 		MtxLck lck(mtx_read_);
-		if (mode_async_) {
-			for (int i = 0; i < n; ++i)
-				crcbuf_read_.push_back(buf_read_[i]);
-		}
-		else byte_read_ = n;
+		byte_read_ = n;
+		tm_active_ = SteadyClock::now();
+		bytes_in_ += n;
 	}
-	cbread_(shared_from_this(), ec);
+	notify_read(ec);
 	if (!ec) start_read();
 }
 
+void TcpClient::reset() {
+	error_code ec;
+	sock_.close(ec);
+	byte_read_ = 0;
+	netbuf_read_.Reset();
+	netbuf_read_.SetMaxLine(TCP_LINE_MAX);
+	que_write_.clear();
+	msg_writing_.clear();
+	byte_write_ = 0;
+	cork_       = 0;
+	bytes_in_   = 0;
+	msg_in_     = 0;
+	stat_       = TcpStat();
+	trace_rtt_  = false;
+	tm_request_ = 0;
+	stamp_kernel_ = false;
+	tm_arrival_ = tm_batch_ = 0;
+	cbconn_.Clear();
+	cbread_.Clear();
+	cbwrite_.Clear();
+	cbline_.Clear();
+	lines_.clear();
+#ifdef USE_IO_URING
+	uring_key_ = 0;
+#endif
+}
+
 void TcpClient::handle_write(const error_code& ec, int n) {
-	if (!ec) {
+	{
 		MtxLck lck(mtx_write_);
-		crcbuf_write_.erase_begin(n);
-		start_write();
+		SteadyClock::time_point now = SteadyClock::now();
+		int us = duration_cast<microseconds>(now - tm_write_).count();
+		stat_.writeUs += us;
+		if (us > stat_.writeMaxUs) stat_.writeMaxUs = us;
+		if (!ec) {
+			stat_.bytesOut += n;
+			stat_.msgOut   += msg_writing_.size();
+			for (MsgVec::iterator it = msg_writing_.begin(); it != msg_writing_.end(); ++it) {
+				if (!it->request) continue;
+				int rtt = steady_us(now) - it->request;
+				++stat_.rttCount;
+				stat_.rttUs += rtt;
+				if (rtt > stat_.rttMaxUs) stat_.rttMaxUs = rtt;
+			}
+		}
+		msg_writing_.clear();
+		if (!ec) {
+			byte_write_ -= n;
+			if (!cork_) start_write();
+		}
+		else {// 连接已失效: 丢弃待发送信息
+			for (MsgQue::iterator it = que_write_.begin(); it != que_write_.end(); ++it) {
+				++stat_.msgDropped;
+				stat_.bytesDropped += it->msg->size();
+			}
+			que_write_.clear();
+			byte_write_ = 0;
+		}
 	}
 	cbwrite_(shared_from_this(), ec);
 }
 
+/////////////////////////////////////////////////////////////////////
+void TcpClientPool::Recycler::operator()(TcpClient* client) const {
+	Pointer ptr = pool.lock();
+	if (ptr.use_count()) ptr->recycle(client);
+	else delete client;
+}
+
+TcpClientPool::TcpClientPool() {
+	capacity_ = TCP_POOL_MAX;
+}
+
+TcpClientPool::~TcpClientPool() {
+	for (ClientVec::iterator it = idle_.begin(); it != idle_.end(); ++it)
+		delete *it;
+}
+
+TcpClientPool::Pointer TcpClientPool::Instance() {
+	static Pointer pool(new TcpClientPool);
+	return pool;
+}
+
+TcpCPtr TcpClientPool::Get() {
+	TcpClient* client(NULL);
+	{
+		MtxLck lck(mtx_);
+		if (!idle_.empty()) {
+			client = idle_.back();
+			idle_.pop_back();
+		}
+	}
+	if (!client) client = new TcpClient(true);
+	return TcpCPtr(client, Recycler(shared_from_this()));
+}
+
+void TcpClientPool::SetCapacity(int n) {
+	if (n < 0) n = 0;
+	MtxLck lck(mtx_);
+	capacity_ = n;
+	while (idle_.size() > (size_t) capacity_) {
+		delete idle_.back();
+		idle_.pop_back();
+	}
+}
+
+int TcpClientPool::Size() {
+	MtxLck lck(mtx_);
+	return idle_.size();
+}
+
+void TcpClientPool::recycle(TcpClient* client) {
+	client->reset();
+	MtxLck lck(mtx_);
+	if (idle_.size() < (size_t) capacity_) idle_.push_back(client);
+	else delete client;
+}
+
 /////////////////////////////////////////////////////////////////////
 /*--------------------- 服务器 ---------------------*/
 TcpServer::TcpServer()
-	: accept_(keep_.GetIOService()) {
+	: accept_(AsioIOServicePool::Instance().GetIOService()) {
+	maxline_ = 0;
+	reuse_port_ = false;
+}
+
+TcpServer::TcpServer(AsioIOServicePool::IOService& ios)
+	: accept_(ios) {
+	maxline_ = 0;
+	reuse_port_ = false;
 }
 
 TcpServer::~TcpServer() {
-	if (accept_.is_open()) {
-		error_code ec;
-		accept_.close(ec);
-	}
+	Close();
 }
 
 void TcpServer::RegisterAccept(const CBSlot &slot) {
-	cbfunc_.connect(slot);
+	cbfunc_ = slot;
+}
+
+void TcpServer::SetMaxLine(int n) {
+	maxline_ = n;
+}
+
+bool TcpServer::SetReusePort(bool reuse) {
+#ifdef SO_REUSEPORT
+	reuse_port_ = reuse;
+	return true;
+#else
+	return false;
+#endif
 }
 
 bool TcpServer::CreateServer(uint16_t port, bool v6) {
 	try {
-		TCP::endpoint endpt(v6 ? TCP::v6() : TCP::v4(), port);
+		Stream::endpoint endpt(TCP::endpoint(v6 ? TCP::v6() : TCP::v4(), port));
 		accept_.open(endpt.protocol());
-		accept_.bind(endpt);
-		accept_.listen(TCP::socket::max_listen_connections);
-		start_accept();
+#ifdef SO_REUSEPORT
+		if (reuse_port_) accept_.set_option(ReusePort(true));
+#endif
+		start_listen(endpt);
+		return true;
+	}
+	catch (std::exception& ex) {
+		return false;
+	}
+}
+
+bool TcpServer::CreateServer(const string& path) {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+	if (path.empty() || path.size() >= sizeof(sockaddr_un::sun_path)) {// 路径须能以'\0'结尾存入sun_path
+		errno = path.empty() ? EINVAL : ENAMETOOLONG;
+		return false;
+	}
+	struct stat st;
+	if (!lstat(path.c_str(), &st) && S_ISSOCK(st.st_mode))	// 删除上次运行遗留的套接口文件
+		unlink(path.c_str());
+
+	try {
+		boost::asio::local::stream_protocol::endpoint local(path);
+		Stream::endpoint endpt(local);
+		accept_.open(endpt.protocol());
+		start_listen(endpt);
+		path_ = path;
 		return true;
 	}
+	catch (boost::system::system_error& ex) {
+		errno = ex.code().value();
+		return false;
+	}
 	catch (std::exception& ex) {
 		return false;
 	}
+#else
+	return false;
+#endif
+}
+
+void TcpServer::Close() {
+	if (accept_.is_open()) {
+		error_code ec;
+		accept_.close(ec);
+	}
+	if (!path_.empty()) {
+		unlink(path_.c_str());
+		path_.clear();
+	}
+}
+
+void TcpServer::start_listen(const Stream::endpoint& endpt) {
+	accept_.bind(endpt);
+	accept_.listen(socket_base::max_listen_connections);
+	accept_.non_blocking(true);
+	for (int i = 0; i < TCP_ACCEPT_PENDING; ++i)
+		start_accept();
 }
 
 void TcpServer::start_accept() {
 	if (accept_.is_open()) {
-		TcpCPtr client = TcpClient::Create();
+		TcpCPtr client = TcpClientPool::Instance()->Get();
 		accept_.async_accept(client->Socket(),
-				boost::bind(&TcpServer::handle_accept, this, client, placeholders::error));
+				boost::bind(&TcpServer::handle_accept, shared_from_this(), client, placeholders::error));
 	}
 }
 
 void TcpServer::handle_accept(const TcpCPtr client, const error_code& ec) {
 	if (!ec) {
-		cbfunc_(client, shared_from_this());
-		client->Start();
+		start_client(client);
+		accept_pending();
+	}
+	if (ec != error::operation_aborted) start_accept();
+}
+
+void TcpServer::accept_pending() {
+	TcpClientPool::Pointer pool = TcpClientPool::Instance();
+	error_code ec;
+	while (accept_.is_open()) {
+		TcpCPtr client = pool->Get();
+		accept_.accept(client->Socket(), ec);
+		if (ec) break;	// 无待处理连接
+		start_client(client);
 	}
-	start_accept();
+}
+
+void TcpServer::start_client(const TcpCPtr client) {
+	if (maxline_ > 0) client->SetMaxLine(maxline_);
+	cbfunc_(client, shared_from_this());
+	client->Start();
 }
 
 /////////////////////////////////////////////////////////////////////
+TcpAcceptor::TcpAcceptor() {
+	shards_  = 1;
+	maxline_ = 0;
+	next_    = 0;
+}
+
+TcpAcceptor::~TcpAcceptor() {
+	Close();
+}
+
+void TcpAcceptor::RegisterAccept(const CBSlot &slot) {
+	cbfunc_ = slot;
+}
+
+void TcpAcceptor::SetShards(int n) {
+	int nmax = AsioIOServicePool::Instance().Size();
+	if (n <= 0 || n > nmax) n = nmax;
+#ifndef SO_REUSEPORT
+	n = 1;
+#endif
+	shards_ = n > 1 ? n : 1;
+}
+
+void TcpAcceptor::SetMaxLine(int n) {
+	maxline_ = n;
+}
+
+bool TcpAcceptor::AddPort(uint16_t port, int tag, bool v6) {
+	const TcpServer::CBSlot& slot = boost::bind(&TcpAcceptor::accept_shard, WeakPtr(shared_from_this()), _1, tag);
+	AsioIOServicePool& pool = AsioIOServicePool::Instance();
+	TcpSVec servers;
+	unsigned int base;
+	{
+		MtxLck lck(mtx_);
+		base = next_;
+		next_ += shards_;
+	}
+	for (int i = 0; i < shards_; ++i) {
+		/* 同一端口的监听套接口依次绑定到相邻的io_service. 不使用池的轮询分配:
+		 * 监听套接口预先创建的网络连接也占用轮询位置, 各分片可能落在同一线程 */
+		TcpSPtr server = TcpServer::Create(pool.GetIOService(base + i));
+		server->RegisterAccept(slot);
+		server->SetMaxLine(maxline_);
+		if (shards_ > 1) server->SetReusePort(true);
+		if (!server->CreateServer(port, v6)) {
+			for (TcpSVec::iterator it = servers.begin(); it != servers.end(); ++it)
+				(*it)->Close();
+			return false;
+		}
+		servers.push_back(server);
+	}
+
+	MtxLck lck(mtx_);
+	servers_.insert(servers_.end(), servers.begin(), servers.end());
+	return true;
+}
+
+bool TcpAcceptor::AddLocal(const string& path, int tag) {
+	const TcpServer::CBSlot& slot = boost::bind(&TcpAcceptor::accept_shard, WeakPtr(shared_from_this()), _1, tag);
+	TcpSPtr server = TcpServer::Create();
+	server->RegisterAccept(slot);
+	server->SetMaxLine(maxline_);
+	if (!server->CreateServer(path)) return false;
+
+	MtxLck lck(mtx_);
+	servers_.push_back(server);
+	return true;
+}
+
+void TcpAcceptor::Close() {
+	MtxLck lck(mtx_);
+	for (TcpSVec::iterator it = servers_.begin(); it != servers_.end(); ++it)
+		(*it)->Close();
+	servers_.clear();
+}
+
+int TcpAcceptor::Size() {
+	MtxLck lck(mtx_);
+	return servers_.size();
+}
+
+void TcpAcceptor::handle_accept(const TcpCPtr client, int tag) {
+	cbfunc_(client, tag);
+}
+
+void TcpAcceptor::accept_shard(const WeakPtr acceptor, const TcpCPtr client, int tag) {
+	Pointer ptr = acceptor.lock();
+	if (ptr) ptr->handle_accept(client, tag);
+	else client->Close();
+}
+
+/////////////////////////////////////////////////////////////////////
+
@@ -14,6 +14,36 @@
  * @date 2020-10-02
  * @note
  * - 优化
+ * @version 1.1
+ * @date 2026-10-16
+ * @note
+ * - 套接口绑定到进程共享的io_service池, 不再为每个实例创建线程
+ * - 异步模式接收缓冲区改为连续存储的NetBuffer, 套接口直接写入缓冲区
+ * - 新增ReadLine(), 不拷贝数据取出完整信息
+ * - 新增ExtractLines(), 一次取出所有完整信息. 查找换行符时仅扫描新到达数据
+ * - 异步模式发送队列改为引用计数的只读信息, 使用聚集写发送多条信息
+ * - 同一信息可投递给多个网络连接, 不再为每个连接拷贝
+ * - 新增Cork()/Uncork(), 暂缓发送直至处理完当前网络事件
+ * - 发送队列按信息类别处理: 控制指令不丢弃; 状态信息按键值只保留最新值;
+ *   一般信息在队列已满时丢弃. 统计被丢弃与被合并的数据量
+ * - 限制接收信息的最大长度. 超长信息被丢弃, 并在下一个换行符处恢复同步
+ * - 异步模式等待数据到达后再准备接收缓冲区. 接收缓冲区按需扩充, 空闲时收缩
+ * - 新增TcpClientPool: 服务器接受的网络连接对象在释放后回收复用
+ * - 服务器同时保持多个未完成的accept, 每次唤醒后接受所有待处理连接
+ * - 新增TcpAcceptor: 在多个端口上监听, 按端口标记网络连接类别.
+ *   可使用SO_REUSEPORT将同一端口分片至多个I/O线程
+ * - 记录最后接收数据的时间. 新增IdleTime()与Probe(), 用于监视网络连接
+ * - 套接口改为通用流式套接口, 可承载TCP与本地(AF_UNIX)连接. 服务器可在本地套接口上监听
+ * - 异步模式接收流程改为无栈协程: 等待可读 -> 读出所有到达数据 -> 分解信息 -> 分发.
+ *   新增RegisterLine(), 在I/O线程中逐条处理信息, 不经过回调队列与线程切换
+ * - 回调函数改为单目标的Delegate, 替代boost::signals2::signal. 调用时不加锁、不分配内存
+ * - RegisterLine()可在连接工作时调用, 与RegisterRead()一起将连接的信息处理移交给其它对象
+ * - 定义USE_IO_URING时异步模式接收改用io_uring multishot接收(IoUring.h), 内核不支持时回退至epoll.
+ *   内核不支持multishot recv时, 首个接收结束后回退至epoll
+ * - 新增GetStat(): 收发数据量与信息数量、发送队列深度及其峰值、等待发送完成的时间、
+ *   被丢弃与被覆盖的数据量, 以及可选的请求-应答往返时间
+ * - 记录每批信息的到达时间. 启用EnableTimestamp()时epoll接收使用内核时间戳(SO_TIMESTAMPNS),
+ *   否则为I/O线程读出数据的时间
  */
 
 #ifndef SRC_ASIOTCP_H_
@@ -21,23 +51,104 @@
 
 #include <boost/system/error_code.hpp>
 #include <boost/asio/ip/tcp.hpp>
-#include <boost/signals2/signal.hpp>
-#include <boost/circular_buffer.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/generic/stream_protocol.hpp>
+#include <boost/asio/basic_socket_acceptor.hpp>
+#include <boost/asio/detail/socket_option.hpp>
+#include <boost/asio/coroutine.hpp>
+#include <boost/chrono/chrono.hpp>
+#include <boost/thread/mutex.hpp>
 #include <boost/smart_ptr/shared_array.hpp>
 #include <boost/smart_ptr/shared_ptr.hpp>
+#include <boost/smart_ptr/weak_ptr.hpp>
 #include <boost/enable_shared_from_this.hpp>
+#include <stdint.h>
 #include <string.h>
+#include <netinet/tcp.h>
 #include <string>
 #include <vector>
+#include <deque>
+#include <atomic>
 #include "AsioIOServiceKeep.h"
+#include "NetBuffer.h"
+#include "Delegate.h"
+#include "IoUring.h"
 
 using namespace boost::system;
 
 /////////////////////////////////////////////////////////////////////
 /*--------------------- 客户端 ---------------------*/
 #define TCP_PACK_SIZE		1500
+#define TCP_GATHER_MAX		64		///< 单次聚集写最多信息数量
+
+#define TCP_WRITE_MAX		(TCP_PACK_SIZE * 50)	///< 发送队列容量, 量纲: 字节
+#define TCP_READ_MAX		(TCP_PACK_SIZE * 50)	///< 接收缓冲区容量, 量纲: 字节
+#define TCP_READ_INIT		(TCP_PACK_SIZE * 2)		///< 接收缓冲区初始容量, 量纲: 字节
+#define TCP_LINE_MAX		(TCP_READ_MAX - TCP_PACK_SIZE)	///< 信息长度上限, 量纲: 字节
+#define TCP_POOL_MAX		256		///< 对象池中保留的空闲网络连接对象最大数量
+#define TCP_READ_BURST		8		///< 异步模式每次唤醒最多读取次数
+
+using TcpMsgPtr = boost::shared_ptr<const std::string>;	///< 待发送信息. 只读, 可投递给多个网络连接
+
+enum {///< 待发送信息类别
+	TCPMSG_NORMAL,		///< 一般信息: 发送队列已满时丢弃
+	TCPMSG_COMMAND,		///< 控制指令: 不丢弃
+	TCPMSG_STATUS		///< 状态信息: 队列中键值相同的未发送信息只保留最新值
+};
+
+/*!
+ * @struct TcpWriteStat
+ * @brief 发送队列统计
+ */
+struct TcpWriteStat {
+	uint64_t msgDropped;		///< 被丢弃的信息数量
+	uint64_t bytesDropped;		///< 被丢弃的数据长度
+	uint64_t msgCoalesced;		///< 被合并的信息数量
+	uint64_t bytesCoalesced;	///< 被合并的数据长度
+
+public:
+	TcpWriteStat() {
+		msgDropped = bytesDropped = 0;
+		msgCoalesced = bytesCoalesced = 0;
+	}
+};
+
+/*!
+ * @struct TcpStat
+ * @brief 网络连接统计
+ * @note
+ * - 被合并(覆盖)的状态信息计入msgCoalesced与bytesCoalesced
+ * - 往返时间: 收到信息至其后第一条发送信息写入套接口的时间. 仅在启用TraceRoundTrip()后统计
+ */
+struct TcpStat : public TcpWriteStat {
+	uint64_t bytesIn;		///< 接收数据长度
+	uint64_t msgIn;			///< 接收信息数量
+	uint64_t bytesOut;		///< 发送数据长度
+	uint64_t msgOut;		///< 发送信息数量
+	int depth;				///< 发送队列中待写入数据长度, 含正在写入的信息
+	int depthMsg;			///< 发送队列中待写入信息数量, 含正在写入的信息
+	int depthMax;			///< 发送队列待写入数据长度峰值
+	uint64_t writeUs;		///< 等待发送完成的累计时间, 量纲: 微秒
+	int writeMaxUs;			///< 单次等待发送完成的最长时间, 量纲: 微秒
+	int blockedMs;			///< 当前发送已等待的时间, 量纲: 毫秒. 0: 未在发送
+	uint64_t rttCount;		///< 往返次数
+	uint64_t rttUs;			///< 往返累计时间, 量纲: 微秒
+	int rttMaxUs;			///< 往返最长时间, 量纲: 微秒
+
+public:
+	TcpStat() {
+		bytesIn = msgIn = bytesOut = msgOut = 0;
+		depth = depthMsg = depthMax = 0;
+		writeUs = 0;
+		writeMaxUs = blockedMs = 0;
+		rttCount = rttUs = 0;
+		rttMaxUs = 0;
+	}
+};
 
 class TcpClient : public boost::enable_shared_from_this<TcpClient> {
+	friend class TcpClientPool;
+
 public:
 	using Pointer = boost::shared_ptr<TcpClient>;
 	/*!
@@ -45,29 +156,73 @@ public:
 	 * @param 1 客户端对象
 	 * @param 2 实例指针
 	 */
-	using CallbackFunc = boost::signals2::signal<void (const Pointer, const error_code&)>;
-	using CBSlot = CallbackFunc::slot_type;
+	using CallbackFunc = Delegate<void (const Pointer, const error_code&)>;
+	using CBSlot = CallbackFunc;
+	/*!
+	 * @brief 声明逐条信息处理函数
+	 * @param 1 客户端对象
+	 * @param 2 信息首地址. 换行符被替换为'\0'. 函数返回后失效
+	 * @param 3 信息长度, 不含换行符
+	 */
+	using LineFunc = Delegate<void (const Pointer, char*, int)>;
 	using TCP = boost::asio::ip::tcp;	// boost::ip::tcp类型
-	using CRCBuff = boost::circular_buffer<char>;	// 字符型循环数组
+	using Stream = boost::asio::generic::stream_protocol;	// 流式套接口: TCP或AF_UNIX
 	using CBuff = boost::shared_array<char>;	//< char型数组
 	using MtxLck = boost::unique_lock<boost::mutex>;	//< 信号灯互斥锁
+	/*!
+	 * @struct Outgoing
+	 * @brief 发送队列中的信息
+	 */
+	struct Outgoing {
+		TcpMsgPtr msg;		//< 信息
+		int type;			//< 信息类别
+		std::string key;	//< 键值. 用于合并状态信息
+		int64_t request;	//< 应答的请求到达时间, 量纲: 微秒. 0: 不是应答
+
+	public:
+		Outgoing(const TcpMsgPtr _msg, int _type, const std::string& _key, int64_t _request = 0)
+			: msg(_msg), type(_type), key(_key), request(_request) {
+		}
+	};
+	using MsgQue = std::deque<Outgoing>;		//< 待发送信息队列
+	using MsgVec = std::vector<Outgoing>;		//< 正在发送信息集合
+	using SteadyClock = boost::chrono::steady_clock;
 
 protected:
 	bool mode_async_;		//< 工作模式: 异步? 异步需要缓冲区
 	/* socket资源 */
-	AsioIOServiceKeep keep_;	//< 提供boost::asio::io_service对象, 并在实例存在期间保持其运行
-	TCP::socket sock_;			//< 套接口
+	AsioIOServicePool::IOService& ios_;	//< 由共享io_service池分配的io_service对象
+	Stream::socket sock_;		//< 套接口
 	/* 读写缓冲区 */
 	int byte_read_;				//< 单次接收数据长度
-	CBuff buf_read_;			//< 缓冲区: 单次接收
-	CRCBuff crcbuf_read_;		//< 缓冲区: 所有接收
-	CRCBuff crcbuf_write_;		//< 缓冲区: 所有待写入
+	CBuff buf_read_;			//< 缓冲区: 单次接收. 同步模式
+	NetBuffer netbuf_read_;		//< 缓冲区: 所有接收. 异步模式
+	MsgQue que_write_;			//< 队列: 所有待写入信息
+	MsgVec msg_writing_;		//< 正在写入的信息
+	int byte_write_;			//< 队列中待写入数据长度
+	int cork_;					//< 暂缓发送计数. 大于0时新信息只进入队列
+	uint64_t bytes_in_;			//< 接收数据长度. 由mtx_read_保护
+	uint64_t msg_in_;			//< 接收信息数量. 由mtx_read_保护
+	TcpStat stat_;				//< 发送统计. 由mtx_write_保护
+	SteadyClock::time_point tm_active_;	//< 最后接收数据的时间
+	SteadyClock::time_point tm_write_;	//< 正在写入的信息开始写入的时间
+	bool trace_rtt_;			//< 统计往返时间
+	bool stamp_kernel_;			//< 使用内核接收时间戳
+	int64_t tm_arrival_;		//< 最后一次读出数据的到达时间, 量纲: 纳秒. 由mtx_read_保护
+	int64_t tm_batch_;			//< 正在逐条处理的信息的到达时间, 量纲: 纳秒. 仅由接收流程访问
+	int64_t tm_request_;		//< 尚未应答的第一条信息的到达时间, 量纲: 微秒. 0: 无. 由mtx_write_保护
 	boost::mutex mtx_read_;		//< 互斥锁: 从套接口读取
 	boost::mutex mtx_write_;	//< 互斥锁: 向套接口写入
+	boost::mutex mtx_cb_;		//< 互斥锁: 替换read回调函数
 	/* 回调接口 */
 	CallbackFunc  cbconn_;	//< connect回调函数
-	CallbackFunc  cbread_;	//< read回调函数
+	CallbackFunc  cbread_;	//< read回调函数. 可在连接工作时被替换, 调用前在mtx_cb_保护下拷贝
 	CallbackFunc  cbwrite_;	//< write回调函数
+	LineFunc      cbline_;	//< 逐条信息处理函数. 在I/O线程中调用, 调用前在mtx_cb_保护下拷贝
+	NetBuffer::LineVec lines_;	//< 逐条处理时一次取出的信息集合. 仅由接收流程访问
+#ifdef USE_IO_URING
+	std::atomic<uint64_t> uring_key_;	//< io_uring接收标识. 0: 未使用io_uring. 在I/O线程写入, Close()在其它线程读取
+#endif
 
 public:
 	TcpClient(bool modeAsync = true);
@@ -83,9 +238,9 @@ public:
 	/*!
 	 * @brief 查看套接字
 	 * @return
-	 * TCP套接字
+	 * 流式套接字. 由服务器接受的连接可能是TCP或本地套接口
 	 */
-	TCP::socket& Socket();
+	Stream::socket& Socket();
 	/*!
 	 * @brief 同步方式尝试连接服务器
 	 * @param host  服务器地址或名称
@@ -122,14 +277,171 @@ public:
 	 * 实际读取数据长度
 	 */
 	int Read(char* data, const int n, const int from = 0);
+	/*!
+	 * @brief 从已接收信息中取出第一条以换行符结束的信息
+	 * @param n  信息长度, 不含换行符
+	 * @return
+	 * 信息首地址. 换行符被替换为'\0'. 若无完整信息则返回NULL
+	 * @note
+	 * - 仅用于异步模式
+	 * - 返回地址指向接收缓冲区, 在下一次调用ReadLine()之前有效
+	 * - 应循环调用至返回NULL, 以释放已交出信息占用的存储区
+	 */
+	char* ReadLine(int& n);
+	/*!
+	 * @brief 从已接收信息中取出所有以换行符结束的信息
+	 * @param lines  信息集合. 换行符被替换为'\0'
+	 * @return
+	 * 信息数量
+	 * @note
+	 * - 仅用于异步模式
+	 * - 信息地址指向接收缓冲区, 在下一次调用ReadLine()、ExtractLines()或ReleaseLines()之前有效
+	 */
+	int ExtractLines(NetBuffer::LineVec& lines);
+	/*!
+	 * @brief 释放已取出的信息, 使接收缓冲区可以被收缩
+	 * @note
+	 * 处理完ExtractLines()取出的信息后调用
+	 */
+	void ReleaseLines();
 	/*!
 	 * @brief 发送指定数据
 	 * @param data 待发送数据存储区指针
 	 * @param n    待发送数据长度
+	 * @param type 信息类别. 仅用于异步模式
+	 * @param key  状态信息键值. 仅用于异步模式
 	 * @return
 	 * 实际发送数据长度
 	 */
-	int Write(const char* data, const int n);
+	int Write(const char* data, const int n, const int type = TCPMSG_NORMAL, const std::string& key = "");
+	/*!
+	 * @brief 发送已封装的信息
+	 * @param msg  待发送信息
+	 * @param type 信息类别
+	 * @param key  状态信息键值. 队列中键值相同的未发送状态信息被替换为msg
+	 * @return
+	 * 发送数据长度. 发送队列已满时返回0
+	 * @note
+	 * - 仅用于异步模式
+	 * - 同一信息可投递给多个网络连接, 信息不被拷贝
+	 * - 控制指令不受发送队列容量限制
+	 */
+	int Write(const TcpMsgPtr msg, const int type = TCPMSG_NORMAL, const std::string& key = "");
+	/*!
+	 * @brief 设置接收信息最大长度
+	 * @param n  信息最大长度, 不含换行符. 取值范围: (0, TCP_LINE_MAX]
+	 * @note
+	 * 超长信息被丢弃, 并在下一个换行符处恢复同步
+	 */
+	void SetMaxLine(int n);
+	/*!
+	 * @brief 收缩接收缓冲区
+	 * @return
+	 * 是否收缩或释放了接收缓冲区
+	 * @note
+	 * 由周期线程调用. 两次调用之间接收过数据时不收缩; 无待处理数据时释放接收缓冲区
+	 */
+	bool ShrinkBuffer();
+	/*!
+	 * @brief 查看占用内存
+	 * @return
+	 * 对象与收发缓冲区占用内存, 量纲: 字节
+	 */
+	int MemoryUsage();
+	/*!
+	 * @brief 查看空闲时间
+	 * @return
+	 * 最后接收数据或建立连接后经过的时间, 量纲: 毫秒
+	 */
+	int IdleTime();
+	/*!
+	 * @brief 由系统以TCP保活报文探测对方是否在线
+	 * @param interval  探测间隔, 量纲: 秒
+	 * @param count     探测次数. 对方未应答时关闭连接
+	 * @return
+	 * 设置结果
+	 * @note
+	 * 对方主机失效时, 连接在interval*count秒后以错误结束
+	 */
+	bool Probe(int interval, int count);
+	/*!
+	 * @brief 检查上次查询后接收缓冲区是否发生溢出
+	 * @param stat  累计溢出统计
+	 * @return
+	 * 上次查询后是否丢弃过接收数据
+	 */
+	bool CheckOverflow(NetReadStat& stat);
+	/*!
+	 * @brief 查看发送队列统计
+	 * @return
+	 * 被丢弃与被合并的信息
+	 */
+	TcpWriteStat GetWriteStat();
+	/*!
+	 * @brief 查看连接统计
+	 * @return
+	 * 收发数据量、发送队列深度、等待发送时间与往返时间
+	 * @note
+	 * 可在任意线程调用
+	 */
+	TcpStat GetStat();
+	/*!
+	 * @brief 查看对方地址
+	 * @return
+	 * TCP连接: 地址:端口; 本地连接: "local"; 连接已断开: 空字符串
+	 */
+	std::string PeerName();
+	/*!
+	 * @brief 启用内核接收时间戳
+	 * @param enable  是否启用
+	 * @return
+	 * 设置结果
+	 * @note
+	 * - 仅作用于epoll接收. io_uring接收与未启用时使用I/O线程读出数据的时间
+	 * - 用于设备状态等需要采样时间的连接
+	 */
+	bool EnableTimestamp(bool enable);
+	/*!
+	 * @brief 查看正在处理的信息的到达时间
+	 * @return
+	 * UTC时间, 自1970-01-01起的纳秒数
+	 * @note
+	 * 在逐条信息处理函数中调用. 同一批读出的信息具有相同的到达时间
+	 */
+	int64_t ArrivalTime() const {
+		return tm_batch_;
+	}
+	/*!
+	 * @brief 查看当前UTC时间
+	 * @return
+	 * 自1970-01-01起的纳秒数. 与ArrivalTime()可比较
+	 */
+	static int64_t RealTime();
+	/*!
+	 * @brief 设置是否统计请求-应答往返时间
+	 * @param enable  是否统计
+	 * @note
+	 * 用于一问一答的协议. 收到信息后第一条发送信息被视为其应答
+	 */
+	void TraceRoundTrip(bool enable);
+	/*!
+	 * @brief 封装待发送信息
+	 * @param data 待发送数据存储区指针
+	 * @param n    待发送数据长度
+	 * @return
+	 * 待发送信息
+	 */
+	static TcpMsgPtr CreateMessage(const char* data, const int n);
+	/*!
+	 * @brief 暂缓发送. 此后写入的信息进入队列, 直至调用Uncork()
+	 * @note
+	 * Cork()与Uncork()成对调用, 可嵌套
+	 */
+	void Cork();
+	/*!
+	 * @brief 恢复发送, 以聚集写发送队列中所有信息
+	 */
+	void Uncork();
 	/*!
 	 * @brief 查找已接收信息中第一个字符
 	 * @param flag 标识符
@@ -158,6 +470,8 @@ public:
 	/*!
 	 * @brief 注册read_some回调函数, 处理收到的网络信息
 	 * @param slot 函数插槽
+	 * @note
+	 * 可在连接工作时调用, 替换原回调函数
 	 */
 	void RegisterRead(const CBSlot& slot);
 	/*!
@@ -165,14 +479,84 @@ public:
 	 * @param slot 函数插槽
 	 */
 	void RegisterWrite(const CBSlot& slot);
+	/*!
+	 * @brief 注册逐条信息处理函数
+	 * @param slot 处理函数
+	 * @note
+	 * - 仅用于异步模式. 可在连接工作时替换, 自下一批信息起生效
+	 * - 注册后接收流程在I/O线程中取出完整信息并逐条调用处理函数, 不再调用read回调函数处理数据;
+	 *   连接断开或出错时仍调用read回调函数
+	 * - 同一批信息的回复合并发送
+	 */
+	void RegisterLine(const LineFunc& slot);
 
 protected:
+	/*!
+	 * @struct ReadLoop
+	 * @brief 异步模式接收流程: 以无栈协程顺序实现等待可读、读出、分发
+	 * @note
+	 * 协程状态只有一个整数, 作为异步操作的回调函数被拷贝
+	 */
+	struct ReadLoop : boost::asio::coroutine {
+		Pointer client;	//< 网络连接. 接收流程持有引用直至连接结束
+
+	public:
+		ReadLoop(const Pointer _client) : client(_client) {
+		}
+		void operator()(const boost::system::error_code& ec = boost::system::error_code());
+	};
+
 	/*!
 	 * @brief 尝试接收网络信息
 	 */
 	void start_read();
+	/*!
+	 * @brief 异步模式读出套接口中已到达的数据
+	 * @param ec 错误代码. 无数据可读不视为错误
+	 * @return
+	 * 读出数据长度
+	 * @note
+	 * 每次最多读取TCP_READ_BURST次, 避免单一连接占用I/O线程
+	 */
+	int read_available(boost::system::error_code& ec);
+	/*!
+	 * @brief 以recvmsg读出数据并取得内核接收时间戳
+	 * @param data   输出存储区
+	 * @param n      存储区长度
+	 * @param stamp  内核接收时间戳, 量纲: 纳秒. 无时间戳时不变
+	 * @param ec     错误代码
+	 * @return
+	 * 读出数据长度
+	 */
+	int read_stamped(char* data, int n, int64_t& stamp, boost::system::error_code& ec);
+	/*!
+	 * @brief 取出所有完整信息并逐条调用处理函数. 未注册处理函数时调用read回调函数
+	 */
+	void dispatch_lines();
+	/*!
+	 * @brief 调用read回调函数
+	 * @param ec 错误代码
+	 */
+	void notify_read(const boost::system::error_code& ec);
+	/*!
+	 * @brief 累计取出的信息, 并登记尚未应答的请求
+	 * @param n  信息数量
+	 * @note
+	 * 调用者持有mtx_read_
+	 */
+	void count_lines(int n);
+#ifdef USE_IO_URING
+	/*!
+	 * @brief 处理io_uring接收结果
+	 * @param data 数据首地址. 函数返回后失效
+	 * @param n    > 0: 数据长度; == 0: 对方关闭连接; < 0: 错误代码的相反数
+	 */
+	void handle_uring(const char* data, int n);
+#endif
 	/*!
 	 * @brief 尝试发送缓冲区数据
+	 * @note
+	 * 调用者持有mtx_write_
 	 */
 	void start_write();
 	/* 响应async_函数的回调函数 */
@@ -182,7 +566,7 @@ protected:
 	 */
 	void handle_connect(const boost::system::error_code& ec);
 	/*!
-	 * @brief 处理收到的网络信息
+	 * @brief 同步模式下处理收到的网络信息
 	 * @param ec 错误代码
 	 * @param n  接收数据长度, 量纲: 字节
 	 */
@@ -193,15 +577,103 @@ protected:
 	 * @param n  发送数据长度, 量纲: 字节
 	 */
 	void handle_write(const boost::system::error_code& ec, int n);
+	/*!
+	 * @brief 关闭套接口, 清除收发缓冲区、统计与回调函数, 恢复初始状态
+	 * @note
+	 * 由对象池在回收时调用, 此时对象不再被引用
+	 */
+	void reset();
 };
 using TcpCPtr = TcpClient::Pointer;
 using TcpCVec = std::vector<TcpCPtr> ; //< 网络连接存储区
 
+/*!
+ * @class TcpClientPool
+ * @brief 异步模式网络连接对象池
+ * @note
+ * - 最后一个引用释放时对象被回收至池中, 不释放内存. 对象池销毁后引用释放的对象直接删除
+ * - 回收时关闭套接口并恢复初始状态, 接收缓冲区被释放
+ * - 对象保持创建时分配的io_service
+ */
+class TcpClientPool : public boost::enable_shared_from_this<TcpClientPool> {
+public:
+	using Pointer = boost::shared_ptr<TcpClientPool>;
+
+protected:
+	using WeakPtr = boost::weak_ptr<TcpClientPool>;
+	using MtxLck = boost::unique_lock<boost::mutex>;
+	using ClientVec = std::vector<TcpClient*>;	//< 空闲对象集合
+	/*!
+	 * @struct Recycler
+	 * @brief 作为TcpCPtr的删除器, 将对象交还对象池
+	 */
+	struct Recycler {
+		WeakPtr pool;	//< 对象池
+
+	public:
+		Recycler(const WeakPtr& _pool)
+			: pool(_pool) {
+		}
+		void operator()(TcpClient* client) const;
+	};
+
+protected:
+	/* 成员变量 */
+	ClientVec idle_;	//< 空闲对象
+	int capacity_;		//< 空闲对象最大数量
+	boost::mutex mtx_;	//< 互斥锁
+
+protected:
+	TcpClientPool();
+
+public:
+	virtual ~TcpClientPool();
+	/*!
+	 * @brief 访问进程内唯一实例
+	 * @return
+	 * 对象池
+	 */
+	static Pointer Instance();
+	/*!
+	 * @brief 取出空闲对象. 无空闲对象时创建新的对象
+	 * @return
+	 * 异步模式网络连接对象
+	 */
+	TcpCPtr Get();
+	/*!
+	 * @brief 设置空闲对象最大数量. 超出数量的空闲对象被删除
+	 * @param n  空闲对象最大数量
+	 */
+	void SetCapacity(int n);
+	/*!
+	 * @brief 查看空闲对象数量
+	 */
+	int Size();
+
+protected:
+	/*!
+	 * @brief 回收对象
+	 * @param client  不再被引用的对象
+	 */
+	void recycle(TcpClient* client);
+};
+
 /////////////////////////////////////////////////////////////////////
 /*--------------------- 服务器 ---------------------*/
+#define TCP_ACCEPT_PENDING	4		///< 同时保持的未完成accept数量
+
+#ifdef SO_REUSEPORT
+/*!
+ * @brief 套接口选项SO_REUSEPORT: 多个监听套接口绑定同一端口, 由内核分配新建连接
+ */
+using ReusePort = boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+#endif
+
 class TcpServer : public boost::enable_shared_from_this<TcpServer> {
 protected:
 	using TCP = boost::asio::ip::tcp;
+	using Stream = boost::asio::generic::stream_protocol;
+	using Acceptor = boost::asio::basic_socket_acceptor<Stream>;
 
 public:
 	using Pointer = boost::shared_ptr<TcpServer>;
@@ -210,16 +682,19 @@ public:
 	 * @param 1 客户端对象
 	 * @param 2 实例指针
 	 */
-	using CallbackFunc = boost::signals2::signal<void (const TcpCPtr, const Pointer)>;
-	using CBSlot = CallbackFunc::slot_type;
+	using CallbackFunc = Delegate<void (const TcpCPtr, const Pointer)>;
+	using CBSlot = CallbackFunc;
 
 protected:
-	AsioIOServiceKeep keep_;	//< 提供boost::asio::io_service对象, 并在实例存在期间保持其运行
-	TCP::acceptor accept_;		//< 网络服务
+	Acceptor accept_;			//< 网络服务: TCP或本地套接口. 回调函数在同一io_service线程中串行执行
+	std::string path_;			//< 本地套接口路径. 关闭服务时删除
 	CallbackFunc cbfunc_;		//< 回调函数
+	int maxline_;				//< 新建连接的接收信息最大长度. <= 0时使用缺省值
+	bool reuse_port_;			//< 是否设置SO_REUSEPORT
 
 public:
 	TcpServer();
+	TcpServer(AsioIOServicePool::IOService& ios);
 	virtual ~TcpServer();
 
 	/*!
@@ -230,22 +705,69 @@ public:
 	static Pointer Create() {
 		return Pointer(new TcpServer);
 	}
+	/*!
+	 * @brief 创建一个实例, 监听套接口绑定到指定的io_service
+	 * @param ios  io_service对象
+	 * @return
+	 * 实例指针
+	 */
+	static Pointer Create(AsioIOServicePool::IOService& ios) {
+		return Pointer(new TcpServer(ios));
+	}
 
 	/*!
 	 * @brief 注册accept回调函数, 处理服务器收到的网络连接请求
 	 * @param slot 函数插槽
 	 */
 	void RegisterAccept(const CBSlot &slot);
+	/*!
+	 * @brief 设置新建连接的接收信息最大长度
+	 * @param n  信息最大长度, 不含换行符
+	 * @note
+	 * 在CreateServer()之前调用
+	 */
+	void SetMaxLine(int n);
+	/*!
+	 * @brief 设置SO_REUSEPORT, 允许多个监听套接口绑定同一端口
+	 * @param reuse  是否设置
+	 * @return
+	 * 系统是否支持SO_REUSEPORT
+	 * @note
+	 * 在CreateServer()之前调用
+	 */
+	bool SetReusePort(bool reuse);
 	/*!
 	 * @brief 尝试在port指定的端口上创建TCP网络服务
 	 * @param port 服务端口
 	 * @param v6   服务类型. true: V6, false: V4
 	 * @return
 	 * TCP网络服务创建结果
+	 * @note
+	 * 同时发起TCP_ACCEPT_PENDING个accept
 	 */
 	bool CreateServer(uint16_t port, bool v6 = false);
+	/*!
+	 * @brief 在path指定的本地(AF_UNIX)套接口上创建网络服务
+	 * @param path 套接口路径. 路径上已存在的套接口文件被删除, 其它类型文件保留
+	 * @return
+	 * 网络服务创建结果. 失败时errno指示原因. 路径长度不小于sun_path时为ENAMETOOLONG
+	 * @note
+	 * 本地连接与TCP连接使用相同的TcpClient接口
+	 */
+	bool CreateServer(const std::string& path);
+	/*!
+	 * @brief 关闭网络服务
+	 * @note
+	 * 未完成的accept被取消, 服务不再接受新的连接
+	 */
+	void Close();
 
 protected:
+	/*!
+	 * @brief 在已打开的套接口上绑定地址并启动网络监听
+	 * @param endpt 地址
+	 */
+	void start_listen(const Stream::endpoint& endpt);
 	/*!
 	 * @brief 启动网络监听
 	 */
@@ -256,8 +778,123 @@ protected:
 	 * @param ec     错误代码
 	 */
 	void handle_accept(const TcpCPtr client, const boost::system::error_code& ec);
+	/*!
+	 * @brief 以非阻塞方式接受所有待处理的网络连接
+	 */
+	void accept_pending();
+	/*!
+	 * @brief 通知新建立的网络连接, 并启动接收流程
+	 * @param client 建立套接字
+	 */
+	void start_client(const TcpCPtr client);
 };
 using TcpSPtr = boost::shared_ptr<TcpServer>;
 
+/*!
+ * @class TcpAcceptor
+ * @brief 多端口网络服务
+ * @note
+ * - 每个端口关联一个标记, 建立的网络连接与其标记一起通知
+ * - 每个端口可创建多个监听套接口, 分布在不同的I/O线程上. 由内核按SO_REUSEPORT分配新建连接
+ * - 使用Create()创建实例. 监听套接口以弱引用回调实例
+ */
+class TcpAcceptor : public boost::enable_shared_from_this<TcpAcceptor> {
+public:
+	using Pointer = boost::shared_ptr<TcpAcceptor>;
+	using WeakPtr = boost::weak_ptr<TcpAcceptor>;
+	/*!
+	 * @brief 声明回调函数及插槽
+	 * @param 1 客户端对象
+	 * @param 2 端口标记
+	 */
+	using CallbackFunc = Delegate<void (const TcpCPtr, int)>;
+	using CBSlot = CallbackFunc;
+
+protected:
+	using TcpSVec = std::vector<TcpSPtr>;
+	using MtxLck = boost::unique_lock<boost::mutex>;
+
+protected:
+	TcpSVec servers_;		//< 监听套接口
+	CallbackFunc cbfunc_;	//< 回调函数
+	int shards_;			//< 每个端口的监听套接口数量
+	int maxline_;			//< 新建连接的接收信息最大长度. <= 0时使用缺省值
+	unsigned int next_;		//< 下一个端口首个监听套接口的io_service索引
+	boost::mutex mtx_;		//< 互斥锁: 监听套接口
+
+public:
+	TcpAcceptor();
+	virtual ~TcpAcceptor();
+	/*!
+	 * @brief 创建一个实例
+	 * @return
+	 * 实例指针
+	 */
+	static Pointer Create() {
+		return Pointer(new TcpAcceptor);
+	}
+	/*!
+	 * @brief 注册accept回调函数, 处理收到的网络连接
+	 * @param slot 函数插槽
+	 */
+	void RegisterAccept(const CBSlot &slot);
+	/*!
+	 * @brief 设置每个端口的监听套接口数量
+	 * @param n  监听套接口数量. <= 0时等于I/O线程数量
+	 * @note
+	 * - 在AddPort()之前调用
+	 * - 数量不超过I/O线程数量. 系统不支持SO_REUSEPORT时数量为1
+	 */
+	void SetShards(int n);
+	/*!
+	 * @brief 设置新建连接的接收信息最大长度
+	 * @param n  信息最大长度, 不含换行符
+	 * @note
+	 * 在AddPort()之前调用
+	 */
+	void SetMaxLine(int n);
+	/*!
+	 * @brief 在port指定的端口上创建TCP网络服务
+	 * @param port 服务端口
+	 * @param tag  端口标记. 随网络连接一起通知
+	 * @param v6   服务类型. true: V6, false: V4
+	 * @return
+	 * TCP网络服务创建结果
+	 */
+	bool AddPort(uint16_t port, int tag, bool v6 = false);
+	/*!
+	 * @brief 在path指定的本地(AF_UNIX)套接口上创建网络服务
+	 * @param path 套接口路径
+	 * @param tag  端口标记. 随网络连接一起通知
+	 * @return
+	 * 网络服务创建结果
+	 */
+	bool AddLocal(const std::string& path, int tag);
+	/*!
+	 * @brief 关闭所有端口上的网络服务
+	 */
+	void Close();
+	/*!
+	 * @brief 查看监听套接口数量
+	 */
+	int Size();
+
+protected:
+	/*!
+	 * @brief 处理监听套接口收到的网络连接
+	 * @param client 建立套接字
+	 * @param tag    端口标记
+	 */
+	void handle_accept(const TcpCPtr client, int tag);
+	/*!
+	 * @brief 监听套接口的回调函数. 实例已释放时关闭网络连接
+	 * @param acceptor 实例弱引用. 监听套接口在I/O线程中回调, 不延长实例的生命周期
+	 * @param client   建立套接字
+	 * @param tag      端口标记
+	 */
+	static void accept_shard(const WeakPtr acceptor, const TcpCPtr client, int tag);
+};
+using TcpAcpPtr = TcpAcceptor::Pointer;
+
 /////////////////////////////////////////////////////////////////////
 #endif /* SRC_ASIOTCP_H_ */
@@ -19,27 +19,44 @@ using namespace boost::asio;
 using namespace boost::placeholders;
 
 UdpSession::UdpSession()
-	: sock_(keep_.GetIOService()) {
+	: sock_(AsioIOServicePool::Instance().GetIOService()) {
 	connected_     = false;
 	block_reading_ = false;
 	byte_read_     = 0;
 	buf_read_.reset(new char[UDP_PACK_SIZE]);
+	batch_   = false;
+	head_    = 0;
+	count_   = 0;
+	dropped_ = 0;
 }
 
 UdpSession::~UdpSession() {
 	Close();
 }
 
+void UdpSession::SetBatchMode(int slots) {
+	if (slots <= 0) slots = UDP_RING_SIZE;
+	MtxLck lck(mtx_read_);
+	batch_ = true;
+	ring_.resize(slots);
+	head_ = count_ = 0;
+#ifdef __linux__
+	mmsg_.resize(slots);
+	iov_.resize(slots);
+#endif
+}
+
 bool UdpSession::Open(uint16_t port, bool v6) {
 	try {
 		sock_.open(v6 ? UDP::v6() : UDP::v4());
+		if (batch_) sock_.non_blocking(true);
 		if (port) {// 在端口启动UDP接收服务
 			sock_.bind(UDP::endpoint(v6 ? UDP::v6() : UDP::v4(), port));
 			start_read();
 		}
 		return true;
 	}
-	catch(error_code &ex) {
+	catch(system_error& ex) {
 		return false;
 	}
 }
@@ -89,6 +106,30 @@ const char* UdpSession::BlockRead(char *buff, int& n, const int millisec) {
 	return n == 0 ? NULL : buff;
 }
 
+int UdpSession::ReadBatch(UdpPktVec& packets) {
+	MtxLck lck(mtx_read_);
+	int slots = ring_.size();
+	int tail  = (head_ - count_ + slots) % (slots ? slots : 1);
+
+	packets.resize(count_);
+	for (int i = 0; i < count_; ++i) {
+		UdpPacket& src = ring_[(tail + i) % slots];
+		UdpPacket& dst = packets[i];
+		memcpy(dst.data, src.data, src.n);
+		dst.data[src.n] = 0;
+		dst.n      = src.n;
+		dst.remote = src.remote;
+		dst.arrival= src.arrival;
+	}
+	count_ = 0;
+	return packets.size();
+}
+
+uint64_t UdpSession::Dropped() {
+	MtxLck lck(mtx_read_);
+	return dropped_;
+}
+
 void UdpSession::Write(const void *data, const int n) {
 	MtxLck lck(mtx_write_);
 	if (connected_) sock_.send(buffer(data, n));
@@ -108,24 +149,26 @@ void UdpSession::WriteTo(const string& ipPeer, const uint16_t portPeer, const vo
 }
 
 void UdpSession::RegisterConnect(const CBSlot &slot) {
-	cbconn_.disconnect_all_slots();
-	cbconn_.connect(slot);
+	cbconn_ = slot;
 }
 
 void UdpSession::RegisterRead(const CBSlot &slot) {
-	cbread_.disconnect_all_slots();
-	cbread_.connect(slot);
+	cbread_ = slot;
 }
 
 void UdpSession::start_read() {
-	if (connected_) {
+	if (batch_) {// 数据到达后批量读出
+		sock_.async_wait(UDP::socket::wait_read,
+				boost::bind(&UdpSession::handle_wait, shared_from_this(), placeholders::error));
+	}
+	else if (connected_) {
 		sock_.async_receive(buffer(buf_read_.get(), UDP_PACK_SIZE),
-				boost::bind(&UdpSession::handle_read, this,
+				boost::bind(&UdpSession::handle_read, shared_from_this(),
 						placeholders::error, placeholders::bytes_transferred));
 	}
 	else {
 		sock_.async_receive_from(buffer(buf_read_.get(), UDP_PACK_SIZE), remote_,
-				boost::bind(&UdpSession::handle_read, this,
+				boost::bind(&UdpSession::handle_read, shared_from_this(),
 						placeholders::error, placeholders::bytes_transferred));
 	}
 }
@@ -138,3 +181,62 @@ void UdpSession::handle_read(const error_code& ec, const int n) {
 		start_read();
 	}
 }
+
+void UdpSession::handle_wait(const error_code& ec) {
+	if (ec) return;
+
+	int n;
+	{
+		MtxLck lck(mtx_read_);
+		n = receive_batch();
+	}
+	if (n) cbread_(shared_from_this(), ec);
+	start_read();
+}
+
+int UdpSession::receive_batch() {
+	int slots = ring_.size();
+	int total(0);
+#ifdef __linux__
+	int fd = sock_.native_handle();
+	int m;
+
+	do {// 按环形缓冲区容量分批读出, 直至无数据包
+		for (int i = 0; i < slots; ++i) {
+			UdpPacket& pkt = ring_[(head_ + i) % slots];
+			iov_[i].iov_base = pkt.data;
+			iov_[i].iov_len  = UDP_PACK_SIZE;
+			memset(&mmsg_[i], 0, sizeof(mmsghdr));
+			mmsg_[i].msg_hdr.msg_name    = pkt.remote.data();
+			mmsg_[i].msg_hdr.msg_namelen = pkt.remote.capacity();
+			mmsg_[i].msg_hdr.msg_iov     = &iov_[i];
+			mmsg_[i].msg_hdr.msg_iovlen  = 1;
+		}
+		if ((m = recvmmsg(fd, &mmsg_[0], slots, MSG_DONTWAIT, NULL)) <= 0) break;
+		for (int i = 0; i < m; ++i) {
+			UdpPacket& pkt = ring_[head_];
+			pkt.n = mmsg_[i].msg_len;
+			pkt.remote.resize(mmsg_[i].msg_hdr.msg_namelen);
+			push_packet();
+		}
+		total += m;
+	} while (m == slots);
+#else
+	error_code ec;
+	while (1) {
+		UdpPacket& pkt = ring_[head_];
+		pkt.n = sock_.receive_from(boost::asio::buffer(pkt.data, UDP_PACK_SIZE), pkt.remote, 0, ec);
+		if (ec && ec != error::message_size) break;
+		push_packet();
+		++total;
+	}
+#endif
+	return total;
+}
+
+void UdpSession::push_packet() {
+	ring_[head_].arrival = AsioIOServicePool::RealTime();
+	head_ = (head_ + 1) % ring_.size();
+	if (count_ < (int) ring_.size()) ++count_;
+	else ++dropped_;	// 覆盖最早的数据包
+}
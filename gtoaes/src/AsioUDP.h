@@ -8,6 +8,17 @@
  * @date Oct 30, 2020
  * @note
  * - 优化
+ * @version 0.3
+ * @date Oct 16, 2026
+ * @note
+ * - 套接口绑定到进程共享的io_service池
+ * - 新增批量接收模式: 每次唤醒时读出所有已到达数据包(Linux下使用recvmmsg),
+ *   存入环形缓冲区, 由ReadBatch()一次取出
+ * - 回调函数改为单目标的Delegate, 替代boost::signals2::signal
+ * @version 0.4
+ * @date Oct 17, 2026
+ * @note
+ * - 批量接收模式记录数据包到达时间, 用于计算安全指令延迟
  */
 
 #ifndef SRC_ASIOUDP_H_
@@ -15,13 +26,31 @@
 
 #include <boost/system/error_code.hpp>
 #include <boost/asio/ip/udp.hpp>
-#include <boost/signals2.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <boost/smart_ptr/shared_array.hpp>
 #include <boost/enable_shared_from_this.hpp>
 #include <string>
+#include <vector>
+#include <stdint.h>
+#include <sys/socket.h>
 #include "AsioIOServiceKeep.h"
+#include "Delegate.h"
 
 #define UDP_PACK_SIZE		1500
+#define UDP_RING_SIZE		256		///< 批量接收模式的环形缓冲区容量, 量纲: 数据包
+
+/*!
+ * @struct UdpPacket
+ * @brief 批量接收模式下的数据包
+ */
+struct UdpPacket {
+	char data[UDP_PACK_SIZE + 1];	///< 数据. 预留一个字节用于结束符
+	int n;							///< 数据长度
+	boost::asio::ip::udp::endpoint remote;	///< 发送方地址
+	int64_t arrival;				///< 到达时间, 自1970-01-01起的纳秒数
+};
+using UdpPktVec = std::vector<UdpPacket>;
 
 using std::string;
 using namespace boost::system;
@@ -39,14 +68,13 @@ public:
 	 * @param 1 客户端对象
 	 * @param 2 错误描述
 	 */
-	using CallbackFunc = boost::signals2::signal<void (const Pointer, const error_code&)>;
-	using CBSlot = CallbackFunc::slot_type;
+	using CallbackFunc = Delegate<void (const Pointer, const error_code&)>;
+	using CBSlot = CallbackFunc;
 	using UDP = boost::asio::ip::udp;	// boost::ip::udp类型
 	using CBuff = boost::shared_array<char>;	//< char型数组
 	using MtxLck = boost::unique_lock<boost::mutex>;	//< 信号灯互斥锁
 
 protected:
-	AsioIOServiceKeep keep_;	//< 提供boost::asio::io_service对象, 并在实例存在期间保持其运行
 	UDP::socket sock_;			//< 套接口
 	UDP::endpoint remote_;		//< 远程套接口
 	bool connected_;			//< 连接标志
@@ -60,6 +88,17 @@ protected:
 	bool block_reading_;	//< 阻塞式读出
 	boost::condition_variable cvread_;	//< 阻塞读出时的条件变量
 
+	/* 批量接收模式 */
+	bool batch_;			//< 批量接收模式
+	UdpPktVec ring_;		//< 环形缓冲区
+	int head_;				//< 下一个写入位置
+	int count_;				//< 未读出数据包数量
+	uint64_t dropped_;		//< 环形缓冲区已满而被覆盖的数据包数量
+#ifdef __linux__
+	std::vector<mmsghdr> mmsg_;	//< recvmmsg()参数
+	std::vector<iovec> iov_;	//< recvmmsg()参数
+#endif
+
 public:
 	/* 接口 */
 	/*!
@@ -75,6 +114,15 @@ public:
 	 * @param v6   是否使用V6协议
 	 */
 	bool Open(uint16_t port = 0, bool v6 = false);
+	/*!
+	 * @brief 启用批量接收模式
+	 * @param slots 环形缓冲区容量, 量纲: 数据包
+	 * @note
+	 * - 在Open()之前调用
+	 * - 每次唤醒时读出所有已到达的数据包, 然后调用一次接收回调函数
+	 * - 环形缓冲区已满时覆盖最早的数据包
+	 */
+	void SetBatchMode(int slots = UDP_RING_SIZE);
 	/*!
 	 * @brief 关闭套接口
 	 */
@@ -116,6 +164,19 @@ public:
 	 * 可读出数据地址
 	 */
 	const char* BlockRead(char *buff, int& n, const int millisec = 100);
+	/*!
+	 * @brief 批量接收模式下取出所有已接收数据包
+	 * @param packets 数据包集合. 按接收顺序排列
+	 * @return
+	 * 数据包数量
+	 */
+	int ReadBatch(UdpPktVec& packets);
+	/*!
+	 * @brief 查看批量接收模式下被覆盖的数据包数量
+	 * @return
+	 * 累计数量
+	 */
+	uint64_t Dropped();
 	/*!
 	 * @brief 将数据写入套接口
 	 * @param data 待发送数据
@@ -152,6 +213,23 @@ protected:
 	 * @param n  接收数据长度, 量纲: 字节
 	 */
 	void handle_read(const error_code& ec, const int n);
+	/*!
+	 * @brief 批量接收模式下处理套接口可读事件
+	 * @param ec 错误代码
+	 */
+	void handle_wait(const error_code& ec);
+	/*!
+	 * @brief 读出所有已到达的数据包并存入环形缓冲区
+	 * @return
+	 * 读出数据包数量
+	 * @note
+	 * 调用者持有mtx_read_
+	 */
+	int receive_batch();
+	/*!
+	 * @brief 存入一个数据包后移动写入位置
+	 */
+	void push_packet();
 };
 using UdpPtr = UdpSession::Pointer;
 
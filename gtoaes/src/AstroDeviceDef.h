@@ -29,6 +29,29 @@ enum {///< 对应主机类型
 	PEER_LAST		///< 占位, 不使用
 };
 
+static const char* peer_desc[] = {
+	"client",
+	"mount",
+	"camera",
+	"mount-annex",
+	"camera-annex"
+};
+
+/*!
+ * @class TypePeer
+ * @brief 主机类型名称
+ */
+class TypePeer {
+public:
+	static bool IsValid(int type) {
+		return type >= PEER_CLIENT && type < PEER_LAST;
+	}
+
+	static const char* ToString(int type) {
+		return IsValid(type) ? peer_desc[type] : "unknown";
+	}
+};
+
 /* 状态与指令 */
 /////////////////////////////////////////////////////////////////////////////
 static const char* netdev_desc[] = {
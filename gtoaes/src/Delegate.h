@@ -0,0 +1,138 @@
+/**
+ * @file Delegate.h
+ * @brief 单目标回调函数, 替代网络事件回调中的boost::signals2::signal
+ * @version 0.1
+ * @date 2026-10-17
+ * @note
+ * - 只保存一个可调用对象. 再次赋值时替换原对象
+ * - 可调用对象存储在对象内部(小对象优化), 构造、拷贝与调用都不分配内存
+ * - 调用为一次间接函数调用, 不遍历插槽链表
+ * - 不加锁: 赋值与调用由使用者保证互斥, 或在调用前拷贝
+ */
+
+#ifndef SRC_DELEGATE_H_
+#define SRC_DELEGATE_H_
+
+#include <new>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+
+#define DELEGATE_STORAGE	(8 * sizeof(void*))	///< 可调用对象最大长度, 量纲: 字节. 可容纳绑定this与两个shared_ptr的成员函数
+
+template <typename Signature> class Delegate;
+
+template <typename R, typename... Args>
+class Delegate<R (Args...)> {
+protected:
+	/*!
+	 * @struct Ops
+	 * @brief 可调用对象的类型相关操作
+	 */
+	struct Ops {
+		R (*invoke)(void*, Args...);			//< 调用
+		void (*copy)(void*, const void*);	//< 拷贝构造
+		void (*destroy)(void*);				//< 析构
+	};
+	using Storage = typename std::aligned_storage<DELEGATE_STORAGE, alignof(void*)>::type;
+
+protected:
+	/* 成员变量 */
+	Storage buf_;		//< 可调用对象存储区
+	const Ops* ops_;	//< 可调用对象操作. 为NULL时未绑定
+
+public:
+	Delegate() : ops_(NULL) {
+	}
+
+	/*!
+	 * @brief 由可调用对象构造, 如boost::bind()的返回值
+	 */
+	template <typename F, typename = typename std::enable_if<
+		!std::is_same<typename std::decay<F>::type, Delegate>::value>::type>
+	Delegate(F&& f) : ops_(NULL) {
+		assign(std::forward<F>(f));
+	}
+
+	Delegate(const Delegate& other) : ops_(NULL) {
+		if (other.ops_) {
+			other.ops_->copy(&buf_, &other.buf_);
+			ops_ = other.ops_;
+		}
+	}
+
+	~Delegate() {
+		Clear();
+	}
+
+	Delegate& operator=(const Delegate& other) {
+		if (this != &other) {
+			Clear();
+			if (other.ops_) {
+				other.ops_->copy(&buf_, &other.buf_);
+				ops_ = other.ops_;
+			}
+		}
+		return *this;
+	}
+
+	/*!
+	 * @brief 解除绑定
+	 */
+	void Clear() {
+		if (ops_) {
+			ops_->destroy(&buf_);
+			ops_ = NULL;
+		}
+	}
+	/*!
+	 * @brief 检查是否已绑定可调用对象
+	 */
+	bool IsEmpty() const {
+		return ops_ == NULL;
+	}
+	explicit operator bool() const {
+		return ops_ != NULL;
+	}
+	/*!
+	 * @brief 调用. 未绑定时不执行, 返回默认值
+	 */
+	R operator()(Args... args) const {
+		if (!ops_) return R();
+		return ops_->invoke(const_cast<Storage*>(&buf_), std::forward<Args>(args)...);
+	}
+
+protected:
+	template <typename F>
+	void assign(F&& f) {
+		using Fn = typename std::decay<F>::type;
+		static_assert(sizeof(Fn) <= DELEGATE_STORAGE, "callable object is too large for Delegate");
+		static_assert(alignof(Fn) <= alignof(Storage), "callable object is over-aligned for Delegate");
+
+		new (&buf_) Fn(std::forward<F>(f));
+		ops_ = &table<Fn>();
+	}
+
+	template <typename Fn>
+	static const Ops& table() {
+		static const Ops ops = { &invoke<Fn>, &copy<Fn>, &destroy<Fn> };
+		return ops;
+	}
+
+	template <typename Fn>
+	static R invoke(void* p, Args... args) {
+		return (*static_cast<Fn*>(p))(std::forward<Args>(args)...);
+	}
+
+	template <typename Fn>
+	static void copy(void* dst, const void* src) {
+		new (dst) Fn(*static_cast<const Fn*>(src));
+	}
+
+	template <typename Fn>
+	static void destroy(void* p) {
+		static_cast<Fn*>(p)->~Fn();
+	}
+};
+
+#endif /* SRC_DELEGATE_H_ */
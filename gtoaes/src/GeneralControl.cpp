@@ -2,6 +2,9 @@
  * @file GeneralControl.h 声明文件, 封装总控服务
  */
 
+#include <algorithm>
+#include <string.h>
+#include <errno.h>
 #include <boost/smart_ptr/make_shared.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/bind/bind.hpp>
@@ -16,7 +19,14 @@ using namespace boost::posix_time;
 using namespace boost::placeholders;
 using namespace AstroUtil;
 
+#define TCP_SUPERVISE_PERIOD	60000	///< 未设置超时的网络连接检查周期, 量纲: 毫秒
+#define TCP_TRIM_IDLE			60000	///< 收缩接收缓冲区的空闲时间, 量纲: 毫秒
+#define TCP_STAT_PERIOD			300000	///< 输出网络连接收发统计的周期, 量纲: 毫秒
+#define TCP_BLOCK_MAX			30000	///< 客户端发送阻塞上限, 量纲: 毫秒. 超过时关闭连接
+#define SAFETY_LATENCY_MAX		100		///< 关闭天窗指令的延迟上限, 量纲: 毫秒. 超过时告警
+
 GeneralControl::GeneralControl() {
+	statRequest_ = false;
 }
 
 GeneralControl::~GeneralControl() {
@@ -28,10 +38,19 @@ bool GeneralControl::Start() {
 	if (!MessageQueue::Start(DAEMON_NAME)) return false;
 	// 加载参数
 	param_.Load(gConfigPath);
+	timeoutPeer_[PEER_CLIENT]       = param_.timeoutClient * 1000;
+	timeoutPeer_[PEER_MOUNT]        = param_.timeoutMount * 1000;
+	timeoutPeer_[PEER_CAMERA]       = param_.timeoutCamera * 1000;
+	timeoutPeer_[PEER_MOUNT_ANNEX]  = param_.timeoutMountAnnex * 1000;
+	timeoutPeer_[PEER_CAMERA_ANNEX] = param_.timeoutCameraAnnex * 1000;
+	tcpCount_ = tcpMemory_ = 0;
 	// 启动网络服务
+	AsioIOServicePool::Instance().Start(param_.ioThreads);
+	_gLog.Write("network I/O runs on %d thread(s)", AsioIOServicePool::Instance().Size());
 	if (!create_all_server()) return false;
-	bufUdp_.reset(new char[UDP_PACK_SIZE]);
-	bufTcp_.reset(new char[TCP_PACK_SIZE]);
+	envPending_ = false;
+	envDropped_ = 0;
+	safetyLatencyMax_ = 0.0;
 	kvProto_    = KvProtocol::Create();
 	nonkvProto_ = NonkvProtocol::Create();
 	// 其它设备初始化
@@ -40,12 +59,24 @@ bool GeneralControl::Start() {
 		ntp_->EnableAutoSynch();
 	}
 	if (param_.dbEnable) dbPtr_ = DatabaseCurl::Create(param_.dbUrl);
+	if (param_.mcastEnable) {
+		mcast_ = StatusMulticast::Create();
+		if (mcast_->Open(param_.mcastGroup, param_.mcastPort, param_.mcastTTL, param_.mcastIface)) {
+			_gLog.Write("publish status to multicast group %s:%d",
+					param_.mcastGroup.c_str(), param_.mcastPort);
+		}
+		else {
+			_gLog.Write(LOG_WARN, "failed to open multicast group %s:%d",
+					param_.mcastGroup.c_str(), param_.mcastPort);
+			mcast_.reset();
+		}
+	}
 	// 观测计划
 	obsPlans_  = ObservationPlan::Create();
 	// 启动线程
 	thrd_odt_.reset(new boost::thread(boost::bind(&GeneralControl::thread_odt, this)));
 	thrd_noon_.reset(new boost::thread(boost::bind(&GeneralControl::thread_noon, this)));
-	thrd_tcpClean_.reset(new boost::thread(boost::bind(&GeneralControl::thread_clean_tcp, this)));
+	thrd_supervise_.reset(new boost::thread(boost::bind(&GeneralControl::thread_supervise, this)));
 
 	return true;
 }
@@ -53,7 +84,8 @@ bool GeneralControl::Start() {
 void GeneralControl::Stop() {
 	MessageQueue::Stop();
 	close_all_server();
-	interrupt_thread(thrd_tcpClean_);
+	interrupt_thread(thrd_supervise_);
+	wheel_.Clear();
 	interrupt_thread(thrd_noon_);
 	interrupt_thread(thrd_odt_);
 	for (OBSSVec::iterator it = obss_.begin(); it != obss_.end(); ++it)
@@ -61,51 +93,65 @@ void GeneralControl::Stop() {
 	for (TcpCVec::iterator it = tcpC_buff_.begin(); it != tcpC_buff_.end(); ++it) {
 		if ((*it)->IsOpen()) (*it)->Close();
 	}
+	if (mcast_.use_count()) mcast_->Close();
+	AsioIOServicePool::Instance().Stop();
+}
+
+void GeneralControl::ReportNetwork() {
+	statRequest_ = true;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 /*----------------- 消息响应 -----------------*/
 void GeneralControl::register_messages() {
-	const CBSlot& slot1 = boost::bind(&GeneralControl::on_tcp_receive, this, _1, _2);
-	const CBSlot& slot2 = boost::bind(&GeneralControl::on_env_changed, this, _1, _2);
+	const PayloadSlot& slot1 = boost::bind(&GeneralControl::on_tcp_receive, this, _1, _2, _3);
+	const CBSlot& slot2 = boost::bind(&GeneralControl::on_env_receive, this, _1, _2);
 
-	RegisterMessage(MSG_TCP_RECEIVE, slot1);
-	RegisterMessage(MSG_ENV_CHANGED, slot2);
+	RegisterPayload(MSG_TCP_RECEIVE, slot1);
+	RegisterMessage(MSG_ENV_RECEIVE, slot2);
 }
 
-void GeneralControl::on_tcp_receive(const long par1, const long par2) {
-	TcpRcvPtr rcvd;
-	{// 取队首
-		MtxLck lck(mtx_tcpRcv_);
-		rcvd = que_tcpRcv_.front();
-		que_tcpRcv_.pop_front();
-	}
+void GeneralControl::on_tcp_receive(const long par1, const long par2, MessagePayload& payload) {
+	TcpRcvPtr rcvd = payload.Take<TcpRcvPtr>();
+	if (!rcvd.use_count()) return;
 
 	TcpCPtr client = rcvd->client;
-	if (rcvd->hadRcvd) {
-		const char term[] = "\n";	// 信息结束符: 换行
-		int lenTerm = strlen(term);	// 结束符长度
-		int pos;
-		while (client->IsOpen() && (pos = client->Lookup(term, lenTerm)) >= 0) {
-			client->Read(bufTcp_.get(), pos + lenTerm);
-			bufTcp_[pos] = 0;
-			resolve_from_peer(client, rcvd->peer);
-		}
+	if (rcvd->hadRcvd) {// 已在I/O线程中解析. 连接已被关闭时丢弃其后的信息
+		if (client->IsOpen()) resolve_from_peer(rcvd);
 	}
 	else {
 		client->Close();
 		close_socket(client, rcvd->peer);
+		erase_coupled_tcp(client);
 	}
 }
 
-void GeneralControl::on_env_changed(const long par1, const long par2) {
-	NfEnvPtr nfEnv;
-	{// 取队首事件
-		MtxLck lck_net(mtx_nfEnv_);
-		nfEnv = que_nfEnv_.front();
-		que_nfEnv_.pop_front();
+void GeneralControl::on_env_receive(const long par1, const long par2) {
+	envPending_.store(false);	// 此后到达的数据包触发新的消息
+
+	uint64_t dropped = udpS_env_->Dropped();
+	if (dropped != envDropped_) {
+		_gLog.Write(LOG_WARN, "%llu environment packet(s) overwritten before processing",
+				(unsigned long long) (dropped - envDropped_));
+		envDropped_ = dropped;
 	}
 
+	NfEnvVec changed;
+	udpS_env_->ReadBatch(pktEnv_);
+	for (UdpPktVec::iterator it = pktEnv_.begin(); it != pktEnv_.end(); ++it) {
+		int n = it->n;
+		if (n && it->data[n - 1] == '\n') {
+			it->data[n - 1] = 0;
+			NfEnvPtr nfEnv = resolve_env(it->data, it->arrival);
+			if (nfEnv.use_count() && std::find(changed.begin(), changed.end(), nfEnv) == changed.end())
+				changed.push_back(nfEnv);
+		}
+	}
+	for (NfEnvVec::iterator it = changed.begin(); it != changed.end(); ++it)
+		check_env(*it);
+}
+
+void GeneralControl::check_env(const NfEnvPtr nfEnv) {
 	/* 响应变化: 关闭天窗 */
 	string gid = nfEnv->gid;
 	if (!(nfEnv->param || (nfEnv->param = param_.GetParamOBSS(gid))))
@@ -119,8 +165,16 @@ void GeneralControl::on_env_changed(const long par1, const long par2) {
 			_gLog.Write("Environment[%s] shows %s", gid.c_str(), safe ? "safe" : "!!! DANGEROUS !!!");
 			nfEnv->safe = safe;
 			if (param->useDomeSlit) {
-				if (!safe)
+				if (!safe) {
 					command_slit(gid, "", CommandSlit::SLITC_CLOSE);
+					if (nfEnv->arrival) {// 延迟: 数据包到达至发出指令
+						double latency = (TcpClient::RealTime() - nfEnv->arrival) * 1E-6;
+						if (latency > safetyLatencyMax_) safetyLatencyMax_ = latency;
+						_gLog.Write(latency > SAFETY_LATENCY_MAX ? LOG_WARN : LOG_NORMAL,
+								"Slit[%s] is commanded to close %.3f ms after the sensor packet arrived. max: %.3f ms",
+								gid.c_str(), latency, safetyLatencyMax_);
+					}
+				}
 				else if (param->robotic && nfEnv->odt > TypeObservationDuration::ODT_DAYTIME)
 					command_slit(gid, "", CommandSlit::SLITC_OPEN);
 			}
@@ -130,109 +184,144 @@ void GeneralControl::on_env_changed(const long par1, const long par2) {
 
 //////////////////////////////////////////////////////////////////////////////
 /*----------------- 网络服务 -----------------*/
-bool GeneralControl::create_server(TcpSPtr *server, const uint16_t port) {
-	const TcpServer::CBSlot& slot = boost::bind(&GeneralControl::network_accept, this, _1, _2);
-	*server = TcpServer::Create();
-	(*server)->RegisterAccept(slot);
-	return (*server)->CreateServer(port);
+bool GeneralControl::create_server(int port, const string& path, int peer) {
+	if (port > 0 && !tcpAcceptor_->AddPort(port, peer)) return false;
+	if (!path.empty() && !tcpAcceptor_->AddLocal(path, peer)) {
+		_gLog.Write(LOG_FAULT, "failed to create local socket <%s> for %s: %s", path.c_str(), TypePeer::ToString(peer),
+				strerror(errno));
+		return false;
+	}
+	return true;
 }
 
 bool GeneralControl::create_all_server() {
 	/* 启动TCP服务 */
-	if (!(     create_server(&tcpS_client_,      param_.portClient)
-			&& create_server(&tcpS_mount_,       param_.portMount)
-			&& create_server(&tcpS_camera_,      param_.portCamera)
-			&& create_server(&tcpS_mountAnnex_,  param_.portMountAnnex)
-			&& create_server(&tcpS_cameraAnnex_, param_.portCameraAnnex))) {
+	const TcpAcceptor::CBSlot& slot = boost::bind(&GeneralControl::network_accept, this, _1, _2);
+	tcpAcceptor_ = TcpAcceptor::Create();
+	tcpAcceptor_->RegisterAccept(slot);
+	tcpAcceptor_->SetMaxLine(param_.maxLine);
+	tcpAcceptor_->SetShards(param_.acceptShards);
+	if (!(     create_server(param_.portClient,      param_.unixClient,      PEER_CLIENT)
+			&& create_server(param_.portMount,       param_.unixMount,       PEER_MOUNT)
+			&& create_server(param_.portCamera,      param_.unixCamera,      PEER_CAMERA)
+			&& create_server(param_.portMountAnnex,  param_.unixMountAnnex,  PEER_MOUNT_ANNEX)
+			&& create_server(param_.portCameraAnnex, param_.unixCameraAnnex, PEER_CAMERA_ANNEX))) {
 		_gLog.Write(LOG_FAULT, "failed to create network server");
 		return false;
 	}
+	_gLog.Write("network server listens on %d socket(s)", tcpAcceptor_->Size());
 	/* 启动UDP服务 */
+	const UdpSession::CBSlot& slotEnv = boost::bind(&GeneralControl::receive_from_env, this, _1, _2);
 	udpS_env_ = UdpSession::Create();
-	if (udpS_env_->Open(param_.portEnv)) {
-		const UdpSession::CBSlot& slot = boost::bind(&GeneralControl::receive_from_env, this, _1, _2);
-		udpS_env_->RegisterRead(slot);
-	}
+	udpS_env_->SetBatchMode();
+	udpS_env_->RegisterRead(slotEnv);
+	udpS_env_->Open(param_.portEnv);
 	return true;
 }
 
-void GeneralControl::close_server(TcpSPtr& server) {
-	if (server.unique()) server.reset();
-}
-
 void GeneralControl::close_all_server() {
-	close_server(tcpS_client_);
-	close_server(tcpS_mount_);
-	close_server(tcpS_camera_);
-	close_server(tcpS_mountAnnex_);
-	close_server(tcpS_cameraAnnex_);
-	if (udpS_env_.unique()) udpS_env_->Close();
+	if (tcpAcceptor_.use_count()) {
+		tcpAcceptor_->Close();
+		tcpAcceptor_.reset();
+	}
+	if (udpS_env_.use_count()) udpS_env_->Close();
 }
 
-void GeneralControl::network_accept(const TcpCPtr client, const TcpSPtr server) {
-	int peer(PEER_CLIENT);
-	if      (server == tcpS_mount_)       peer = PEER_MOUNT;
-	else if (server == tcpS_camera_)      peer = PEER_CAMERA;
-	else if (server == tcpS_mountAnnex_)  peer = PEER_MOUNT_ANNEX;
-	else if (server == tcpS_cameraAnnex_) peer = PEER_CAMERA_ANNEX;
-
+void GeneralControl::network_accept(const TcpCPtr client, int peer) {
 	MtxLck lck(mtx_tcpC_buff_);
 	const TcpClient::CBSlot& slot = boost::bind(&GeneralControl::receive_from_peer, this, _1, _2, peer);
+	CodecPtr codec = ProtocolCodec::Create(kvProto_, nonkvProto_, peer, &statCodec_);
+	SlotGroupPtr status = SlotGroup::Create();
+	const TcpClient::LineFunc& slotLine = boost::bind(&GeneralControl::parse_from_peer, this, _1, _2, _3, codec, status);
 	client->RegisterRead(slot);
+	client->RegisterLine(slotLine);
+	if (peer == PEER_CLIENT) client->TraceRoundTrip(true);	// 客户端为一问一答
+	else client->EnableTimestamp(true);	// 设备状态使用内核接收时间戳
 	tcpC_buff_.push_back(client);
+	// 监视网络连接
+	int timeout = timeoutPeer_[peer];
+	TcpSvPtr sv = TcpSupervise::Create(client, peer, timeout);
+	{
+		MtxLck lck(mtx_tcpSv_);
+		tcpSv_.push_back(sv);
+	}
+	wheel_.Schedule(sv, timeout > 0 ? timeout / 2 : TCP_SUPERVISE_PERIOD);
 }
 
 void GeneralControl::receive_from_peer(const TcpCPtr client, const error_code& ec, int peer) {
-	MtxLck lck(mtx_tcpRcv_);
-	TcpRcvPtr rcvd = TcpReceived::Create(client, peer, !ec);
-	que_tcpRcv_.push_back(rcvd);
-	PostMessage(MSG_TCP_RECEIVE);
+	PostMessage(MSG_TCP_RECEIVE, MessagePayload(TcpReceived::Create(client, peer, !ec)));
+}
+
+void GeneralControl::parse_from_peer(const TcpCPtr client, char* line, int n, const CodecPtr codec,
+		const SlotGroupPtr status) {
+	int peer = codec->Peer();
+	TcpRcvPtr rcvd = TcpReceived::Create(client, peer, true);
+	NetReadStat statRead;
+
+	if (client->CheckOverflow(statRead)) {
+		_gLog.Write(LOG_WARN, "%s sent oversized data. discarded lines: %llu, bytes: %llu; overrun bytes: %llu",
+				TypePeer::ToString(peer),
+				(unsigned long long) statRead.linesDiscarded,
+				(unsigned long long) statRead.bytesDiscarded,
+				(unsigned long long) statRead.bytesOverrun);
+	}
+	if (!codec->Decode(line, *rcvd)) rcvd->rcvd.assign(line, n);
+	else if (rcvd->kv.use_count()) rcvd->kv->arrival = client->ArrivalTime();
+	else rcvd->nonkv->arrival = client->ArrivalTime();
+	if (rcvd->IsStatus()) {// 只合并同一设备的状态
+		SlotPtr slot = status->Find(rcvd->StatusKey());
+		PostMessage(MSG_TCP_RECEIVE, slot, MessagePayload(std::move(rcvd)));
+	}
+	else if (rcvd->IsSafety()) SendMessage(MSG_TCP_RECEIVE, MessagePayload(std::move(rcvd)));
+	else {
+		status->Seal();	// 其后的状态不再并入已排队的状态, 保持与本条信息的顺序
+		PostMessage(MSG_TCP_RECEIVE, MessagePayload(std::move(rcvd)));
+	}
 }
 
 void GeneralControl::receive_from_env(const UdpPtr client, const error_code& ec) {
-	int n;
+	// 未处理的数据包由同一消息批量处理. 经安全通道投递
+	// 队列已满时投递阻塞并等待消息响应线程, 因此不持有锁
+	if (!envPending_.exchange(true)) SendMessage(MSG_ENV_RECEIVE);
+}
 
-	if (client->Read(bufUdp_.get(), n) && bufUdp_[n - 1] == '\n') {
-		bufUdp_[n - 1] = 0;
-		/* 解析气象信息 */
-		kvbase base = kvProto_->ResolveEnv(bufUdp_.get());
-		string gid  = base->gid;
-		NfEnvPtr nfEnv = find_info_env(gid);
-
-		if (nfEnv.use_count()) {
-			string type = base->type;
-			bool changed(false);
-
-			if (iequals(type, KVTYPE_RAINFALL)) {
-				kvrain proto = from_kvbase<kv_proto_rainfall>(base);
-				if (nfEnv->rain != proto->value) {
-					nfEnv->rain = proto->value;
-					changed = true;
-				}
-			}
-			else if (iequals(type, KVTYPE_WIND)) {
-				kvwind proto = from_kvbase<kv_proto_wind>(base);
-				nfEnv->orient = proto->orient;
-				if (nfEnv->speed != proto->speed) {
-					nfEnv->speed = proto->speed;
-					changed = true;
-				}
+GeneralControl::NfEnvPtr GeneralControl::resolve_env(const char* rcvd, int64_t arrival) {
+	/* 解析气象信息 */
+	kvbase base = kvProto_->ResolveEnv(rcvd);
+	if (!base.use_count()) return NfEnvPtr();
+	string gid  = base->gid;
+	NfEnvPtr nfEnv = find_info_env(gid);
+
+	if (nfEnv.use_count()) {
+		string type = base->type;
+		bool changed(false);
+
+		if (iequals(type, KVTYPE_RAINFALL)) {
+			kvrain proto = from_kvbase<kv_proto_rainfall>(base);
+			if (nfEnv->rain != proto->value) {
+				nfEnv->rain = proto->value;
+				changed = true;
 			}
-			else if (iequals(type, KVTYPE_CLOUD)) {
-				kvcloud proto = from_kvbase<kv_proto_cloud>(base);
-				if (nfEnv->cloud != proto->value) {
-					nfEnv->cloud = proto->value;
-					changed = true;
-				}
+		}
+		else if (iequals(type, KVTYPE_WIND)) {
+			kvwind proto = from_kvbase<kv_proto_wind>(base);
+			nfEnv->orient = proto->orient;
+			if (nfEnv->speed != proto->speed) {
+				nfEnv->speed = proto->speed;
+				changed = true;
 			}
-
-			if (changed) {
-				MtxLck lck(mtx_nfEnv_);
-				que_nfEnv_.push_back(nfEnv);
-				PostMessage(MSG_ENV_CHANGED);
+		}
+		else if (iequals(type, KVTYPE_CLOUD)) {
+			kvcloud proto = from_kvbase<kv_proto_cloud>(base);
+			if (nfEnv->cloud != proto->value) {
+				nfEnv->cloud = proto->value;
+				changed = true;
 			}
 		}
+		if (!changed) nfEnv.reset();
+		else nfEnv->arrival = arrival;
 	}
+	return nfEnv;
 }
 
 void GeneralControl::erase_coupled_tcp(const TcpCPtr client) {
@@ -263,276 +352,245 @@ void GeneralControl::close_socket(const TcpCPtr client, int peer) {
 
 //////////////////////////////////////////////////////////////////////////////
 /*----------------- 解析/执行通信协议 -----------------*/
-void GeneralControl::resolve_from_peer(const TcpCPtr client, int peer) {
-	const char prefix[] = "g#";	// 非键值对格式的引导符
-	int lenPre  = strlen(prefix);	// 引导符长度
+void GeneralControl::resolve_from_peer(const TcpRcvPtr rcvd) {
+	TcpCPtr client = rcvd->client;
+	int peer = rcvd->peer;
 
-	if (strstr(bufTcp_.get(), prefix)) {// 非键值对协议
-		nonkvbase base = nonkvProto_->Resove(bufTcp_.get() + lenPre);
-		if (base.unique()) {
-			if      (peer == PEER_MOUNT)       process_nonkv_mount      (client, base);
-			else if (peer == PEER_MOUNT_ANNEX) process_nonkv_mount_annex(client, base);
-		}
-		else {
-			_gLog.Write(LOG_FAULT, "unknown protocol from %s: [%s]",
-					peer == PEER_MOUNT ? "mount" : "mount-annex",
-					bufTcp_.get());
-			client->Close();
-		}
+	if (rcvd->nonkv.use_count()) {// 非键值对协议
+		if      (peer == PEER_MOUNT)       process_nonkv_mount      (client, rcvd->nonkv);
+		else if (peer == PEER_MOUNT_ANNEX) process_nonkv_mount_annex(client, rcvd->nonkv);
+	}
+	else if (rcvd->kv.use_count()) {// 键值对协议
+		if      (peer == PEER_CLIENT)       process_kv_client      (client, rcvd->kv);
+		else if (peer == PEER_MOUNT)        process_kv_mount       (client, rcvd->kv);
+		else if (peer == PEER_CAMERA)       process_kv_camera      (client, rcvd->kv);
+		else if (peer == PEER_MOUNT_ANNEX)  process_kv_mount_annex (client, rcvd->kv);
+		else if (peer == PEER_CAMERA_ANNEX) process_kv_camera_annex(client, rcvd->kv);
 	}
-	else {// 键值对协议
-		if      (peer == PEER_CLIENT)       resolve_kv_client      (client);
-		else if (peer == PEER_MOUNT)        resolve_kv_mount       (client);
-		else if (peer == PEER_CAMERA)       resolve_kv_camera      (client);
-		else if (peer == PEER_MOUNT_ANNEX)  resolve_kv_mount_annex (client);
-		else if (peer == PEER_CAMERA_ANNEX) resolve_kv_camera_annex(client);
+	else {
+		_gLog.Write(LOG_FAULT, "unknown protocol from %s: [%s]", TypePeer::ToString(peer), rcvd->rcvd.c_str());
+		client->Close();
 	}
 }
 
-void GeneralControl::resolve_kv_client(const TcpCPtr client) {
+void GeneralControl::process_kv_client(const TcpCPtr client, kvbase base) {
 	/*
 	 * 客户端接收到的信息, 分为两种处理方式:
 	 * 1. 本地处理
 	 * 2. 投递给观测系统
 	 */
-	kvbase base = kvProto_->ResolveClient(bufTcp_.get());
-	if (!base.unique()) {
-		_gLog.Write(LOG_FAULT, "unknown protocol from client: [%s]", bufTcp_.get());
-		client->Close();
-	}
-	else {
-		string type = base->type;
-		string gid  = base->gid;
-		string uid  = base->uid;
-
-		/////////////////////////////////////////////////////////////////////////
-		/*>!!!!!! 新的观测计划 !!!!!!<*/
-		if (iequals(type, KVTYPE_APPPLAN) || iequals(type, KVTYPE_IMPPLAN)) {
-			ObsPlanItemPtr plan;
-			bool opNow = (type[0] == 'a' || type[0] == 'A') ? false : true;
-			int retc;
-			plan = opNow ? from_kvbase<kv_proto_implement_plan>(base)->plan
-					: from_kvbase<kv_proto_append_plan>(base)->plan;
-			if ((retc = plan->CompleteCheck()) == 0) {// 计划加入队列, 并判定是否立即尝试执行
-				obsPlans_->AddPlan(plan);
-				if (opNow) try_implement_plan(plan);
-			}
-			else {
-				_gLog.Write(LOG_FAULT, "plan[%s] couldn't pass validity check. %s", plan->plan_sn.c_str(),
-						retc == 1 ? "plan_sn is empty"
-							: (retc == 2 ? "wrong image type"
-								: (retc == 3 ? "expdur should be not less than 0"
-									: (retc == 4 ? "frmcnt should be not 0"
-										: "period of between begin and end is less than exposure cycle"))));
-			}
+	string type = base->type;
+	string gid  = base->gid;
+	string uid  = base->uid;
+
+	/////////////////////////////////////////////////////////////////////////
+	/*>!!!!!! 新的观测计划 !!!!!!<*/
+	if (iequals(type, KVTYPE_APPPLAN) || iequals(type, KVTYPE_IMPPLAN)) {
+		ObsPlanItemPtr plan;
+		bool opNow = (type[0] == 'a' || type[0] == 'A') ? false : true;
+		int retc;
+		plan = opNow ? from_kvbase<kv_proto_implement_plan>(base)->plan
+				: from_kvbase<kv_proto_append_plan>(base)->plan;
+		if ((retc = plan->CompleteCheck()) == 0) {// 计划加入队列, 并判定是否立即尝试执行
+			obsPlans_->AddPlan(plan);
+			if (opNow) try_implement_plan(plan);
 		}
-		/////////////////////////////////////////////////////////////////////////
-		/*>!!!!!! 中止观测计划 !!!!!!<*/
-		else if (iequals(type, KVTYPE_ABTPLAN)) {
-			try_abort_plan(from_kvbase<kv_proto_abort_plan>(base)->plan_sn);
-		}
-		/////////////////////////////////////////////////////////////////////////
-		/*>!!!!!! 检查观测计划 !!!!!!<*/
-		else if (iequals(type, KVTYPE_CHKPLAN)) {
-			string plan_sn = from_kvbase<kv_proto_check_plan>(base)->plan_sn;
-			ObsPlanItemPtr plan = obsPlans_->Find(plan_sn);
-			kvplan proto = boost::make_shared<kv_proto_plan>();
-			const char* s;
-			int n;
-
-			proto->plan_sn = plan_sn;
-			if (plan.use_count()) proto->state = plan->state;
-			else proto->state = StateObservationPlan::OBSPLAN_ERROR;
-			s = kvProto_->CompactPlan(proto, n);
-			client->Write(s, n);
-		}
-		/////////////////////////////////////////////////////////////////////////
-		/*>!!!!!! 关联观测系统 !!!!!!<*/
-		else if (iequals(type, KVTYPE_REG)) {
-			MtxLck lck(mtx_obss_);
-			int matched(0);
-			for (OBSSVec::iterator it = obss_.begin(); it != obss_.end() && matched != 1; ++it) {
-				if ((matched = (*it)->IsMatched(gid, uid))) (*it)->CoupleClient(client);
-			}
+		else {
+			_gLog.Write(LOG_FAULT, "plan[%s] couldn't pass validity check. %s", plan->plan_sn.c_str(),
+					retc == 1 ? "plan_sn is empty"
+						: (retc == 2 ? "wrong image type"
+							: (retc == 3 ? "expdur should be not less than 0"
+								: (retc == 4 ? "frmcnt should be not 0"
+									: "period of between begin and end is less than exposure cycle"))));
 		}
-		/////////////////////////////////////////////////////////////////////////
-		/*>!!!!!! 解除与观测系统的关联 !!!!!!<*/
-		else if (iequals(type, KVTYPE_UNREG)) {
-			MtxLck lck(mtx_obss_);
-			int matched(0);
-			for (OBSSVec::iterator it = obss_.begin(); it != obss_.end() && matched != 1; ++it) {
-				if ((matched = (*it)->IsMatched(gid, uid))) (*it)->DecoupleClient(client);
-			}
+	}
+	/////////////////////////////////////////////////////////////////////////
+	/*>!!!!!! 中止观测计划 !!!!!!<*/
+	else if (iequals(type, KVTYPE_ABTPLAN)) {
+		try_abort_plan(from_kvbase<kv_proto_abort_plan>(base)->plan_sn);
+	}
+	/////////////////////////////////////////////////////////////////////////
+	/*>!!!!!! 检查观测计划 !!!!!!<*/
+	else if (iequals(type, KVTYPE_CHKPLAN)) {
+		string plan_sn = from_kvbase<kv_proto_check_plan>(base)->plan_sn;
+		ObsPlanItemPtr plan = obsPlans_->Find(plan_sn);
+		kvplan proto = boost::make_shared<kv_proto_plan>();
+		const char* s;
+		int n;
+
+		proto->plan_sn = plan_sn;
+		if (plan.use_count()) proto->state = plan->state;
+		else proto->state = StateObservationPlan::OBSPLAN_ERROR;
+		s = kvProto_->CompactPlan(proto, n);
+		client->Write(s, n);
+	}
+	/////////////////////////////////////////////////////////////////////////
+	/*>!!!!!! 关联观测系统 !!!!!!<*/
+	else if (iequals(type, KVTYPE_REG)) {
+		MtxLck lck(mtx_obss_);
+		int matched(0);
+		for (OBSSVec::iterator it = obss_.begin(); it != obss_.end() && matched != 1; ++it) {
+			if ((matched = (*it)->IsMatched(gid, uid))) (*it)->CoupleClient(client);
 		}
-		/////////////////////////////////////////////////////////////////////////
-		/*>!!!!!! 开关天窗 !!!!!!<*/
-		else if (iequals(type, KVTYPE_SLIT)) {
-			command_slit(gid, uid, from_kvbase<kv_proto_slit>(base)->command);
+	}
+	/////////////////////////////////////////////////////////////////////////
+	/*>!!!!!! 解除与观测系统的关联 !!!!!!<*/
+	else if (iequals(type, KVTYPE_UNREG)) {
+		MtxLck lck(mtx_obss_);
+		int matched(0);
+		for (OBSSVec::iterator it = obss_.begin(); it != obss_.end() && matched != 1; ++it) {
+			if ((matched = (*it)->IsMatched(gid, uid))) (*it)->DecoupleClient(client);
 		}
-		/////////////////////////////////////////////////////////////////////////
-		/*>!!!!!! 投递到观测系统 !!!!!!<*/
-		else {
-			MtxLck lck(mtx_obss_);
-			int matched(0);
-			for (OBSSVec::iterator it = obss_.begin(); it != obss_.end() && matched != 1; ++it) {
-				if ((matched = (*it)->IsMatched(gid, uid))) (*it)->NotifyKVClient(base);
-			}
+	}
+	/////////////////////////////////////////////////////////////////////////
+	/*>!!!!!! 开关天窗 !!!!!!<*/
+	else if (iequals(type, KVTYPE_SLIT)) {
+		command_slit(gid, uid, from_kvbase<kv_proto_slit>(base)->command);
+	}
+	/////////////////////////////////////////////////////////////////////////
+	/*>!!!!!! 投递到观测系统 !!!!!!<*/
+	else {
+		MtxLck lck(mtx_obss_);
+		int matched(0);
+		for (OBSSVec::iterator it = obss_.begin(); it != obss_.end() && matched != 1; ++it) {
+			if ((matched = (*it)->IsMatched(gid, uid))) (*it)->NotifyKVClient(base);
 		}
 	}
 } // process_kv_client(kvbase proto, const TcpCPtr client)
 
-void GeneralControl::resolve_kv_mount(const TcpCPtr client) {
-	kvbase base = kvProto_->ResolveMount(bufTcp_.get());
+void GeneralControl::process_kv_mount(const TcpCPtr client, kvbase base) {
 	bool success(false);
-	if (!base.unique()) {
-		_gLog.Write(LOG_FAULT, "unknown protocol from mount: [%s]", bufTcp_.get());
-	}
-	else {// kv协议的转台连接耦合到观测系统
-		string gid = base->gid;
-		string uid = base->uid;
-		if (gid.empty() || uid.empty()) {
-			_gLog.Write(LOG_FAULT, "requires non-empty mount IDs[%s:%s]",
-					gid.c_str(), uid.c_str());
-		}
-		else {
-			ObsSysPtr obss = find_obss(gid, uid);
-			if (obss.use_count()) {
-				int mode;
-				if ((mode = obss->CoupleMount(client, base))) {// P2P或P2H模式
-					if (mode == MODE_P2P) erase_coupled_tcp(client);
-					success = true;
-				}
-				else {
-					_gLog.Write(LOG_FAULT, "failed to couple mount with OBSS[%s:%s]", gid.c_str(), uid.c_str());
-				}
+	// kv协议的转台连接耦合到观测系统
+	string gid = base->gid;
+	string uid = base->uid;
+	if (gid.empty() || uid.empty()) {
+		_gLog.Write(LOG_FAULT, "requires non-empty mount IDs[%s:%s]",
+				gid.c_str(), uid.c_str());
+	}
+	else {
+		ObsSysPtr obss = find_obss(gid, uid);
+		if (obss.use_count()) {
+			int mode;
+			if ((mode = obss->CoupleMount(client, base))) {// P2P或P2H模式
+				if (mode == MODE_P2P) erase_coupled_tcp(client);
+				success = true;
 			}
 			else {
-				_gLog.Write(LOG_FAULT, "no OBSS[%s:%s] found for mount", gid.c_str(), uid.c_str());
+				_gLog.Write(LOG_FAULT, "failed to couple mount with OBSS[%s:%s]", gid.c_str(), uid.c_str());
 			}
 		}
+		else {
+			_gLog.Write(LOG_FAULT, "no OBSS[%s:%s] found for mount", gid.c_str(), uid.c_str());
+		}
 	}
 	if (!success) client->Close();
 }
 
-void GeneralControl::resolve_kv_camera(const TcpCPtr client) {
-	kvbase base = kvProto_->ResolveCamera(bufTcp_.get());
+void GeneralControl::process_kv_camera(const TcpCPtr client, kvbase base) {
 	bool success(false);
-	if (!base.unique()) {
-		_gLog.Write(LOG_FAULT, "unknown protocol from camera: [%s]", bufTcp_.get());
-	}
-	else {// kv协议的相机连接耦合到观测系统
-		string gid  = base->gid;
-		string uid  = base->uid;
-		string cid  = base->cid;
-		if (gid.empty() || uid.empty() || cid.empty()) {
-			_gLog.Write(LOG_FAULT, "requires non-empty camera IDs[%s:%s:%s]",
-					gid.c_str(), uid.c_str(), cid.c_str());
-		}
-		else {
-			ObsSysPtr obss = find_obss(gid, uid);
-			if (obss.use_count()) {
-				int mode;
-				if ((mode = obss->CoupleCamera(client, base))) {// P2P或P2H模式
-					if (mode == MODE_P2P) erase_coupled_tcp(client);
-					success = true;
-				}
-				else {
-					_gLog.Write(LOG_FAULT, "failed to couple camera[%s] with OBSS[%s:%s]",
-							cid.c_str(), gid.c_str(), uid.c_str());
-				}
+	// kv协议的相机连接耦合到观测系统
+	string gid  = base->gid;
+	string uid  = base->uid;
+	string cid  = base->cid;
+	if (gid.empty() || uid.empty() || cid.empty()) {
+		_gLog.Write(LOG_FAULT, "requires non-empty camera IDs[%s:%s:%s]",
+				gid.c_str(), uid.c_str(), cid.c_str());
+	}
+	else {
+		ObsSysPtr obss = find_obss(gid, uid);
+		if (obss.use_count()) {
+			int mode;
+			if ((mode = obss->CoupleCamera(client, base))) {// P2P或P2H模式
+				if (mode == MODE_P2P) erase_coupled_tcp(client);
+				success = true;
 			}
 			else {
-				_gLog.Write(LOG_FAULT, "no OBSS[%s:%s] found for camera[%s]",
-						gid.c_str(), uid.c_str(), cid.c_str());
+				_gLog.Write(LOG_FAULT, "failed to couple camera[%s] with OBSS[%s:%s]",
+						cid.c_str(), gid.c_str(), uid.c_str());
 			}
 		}
+		else {
+			_gLog.Write(LOG_FAULT, "no OBSS[%s:%s] found for camera[%s]",
+					gid.c_str(), uid.c_str(), cid.c_str());
+		}
 	}
 	if (!success) client->Close();
 }
 
-void GeneralControl::resolve_kv_mount_annex(const TcpCPtr client) {
-	kvbase base = kvProto_->ResolveMountAnnex(bufTcp_.get());
+void GeneralControl::process_kv_mount_annex(const TcpCPtr client, kvbase base) {
 	bool success(false);
-	if (!base.unique()) {
-		_gLog.Write(LOG_FAULT, "unknown protocol from mount-annex: [%s]", bufTcp_.get());
-	}
-	else {// kv协议的转台连接耦合到观测系统
-		string gid = base->gid;
-		string uid = base->uid;
-		if (gid.empty() || (uid.empty() && !iequals(base->type, KVTYPE_SLIT))) {
-			_gLog.Write(LOG_FAULT, "illegal protocol from mount-annex: [%s]", bufTcp_.get());
-		}
-		else if (uid.empty()) {
-			int state = from_kvbase<kv_proto_slit>(base)->state;
-			SlitMulPtr slit = find_slit(gid, client, true);
-			if (slit.use_count()) {// 通知相关观测系统天窗状态
-				if (state != slit->state) {
-					_gLog.Write("Slit[%s] is %s", StateSlit::ToString(state));
-					slit->state = state;
-				}
-				MtxLck lck(mtx_obss_);
-				OBSSVec::iterator itend = obss_.end();
-				for (OBSSVec::iterator it = obss_.begin(); it != itend; ++it) {
-					if ((*it)->IsMatched(gid, uid)) (*it)->NotifySlitState(state);
-				}
-				success = true;
+	// kv协议的转台连接耦合到观测系统
+	string gid = base->gid;
+	string uid = base->uid;
+	if (gid.empty() || (uid.empty() && !iequals(base->type, KVTYPE_SLIT))) {
+		_gLog.Write(LOG_FAULT, "illegal protocol from mount-annex: [%s gid=%s,uid=%s]",
+				base->type.c_str(), gid.c_str(), uid.c_str());
+	}
+	else if (uid.empty()) {
+		int state = from_kvbase<kv_proto_slit>(base)->state;
+		SlitMulPtr slit = find_slit(gid, client, true);
+		if (slit.use_count()) {// 通知相关观测系统天窗状态
+			if (state != slit->state) {
+				_gLog.Write("Slit[%s] is %s", gid.c_str(), StateSlit::ToString(state));
+				slit->state = state;
 			}
-			else {
-				_gLog.Write(LOG_FAULT, "no settings found for slit[%s]", gid.c_str());
+			MtxLck lck(mtx_obss_);
+			OBSSVec::iterator itend = obss_.end();
+			for (OBSSVec::iterator it = obss_.begin(); it != itend; ++it) {
+				if ((*it)->IsMatched(gid, uid)) (*it)->NotifySlitState(state);
 			}
+			success = true;
 		}
-		else {// 当(gid, uid)都不为空时, 投递到观测系统
-			ObsSysPtr obss = find_obss(gid, uid);
-			if (obss.use_count()) {
-				int mode;
-				if ((mode = obss->CoupleMountAnnex(client, base))) {// P2P或P2H模式
-					if (mode == MODE_P2P) erase_coupled_tcp(client);
-					success = true;
-				}
-				else {
-					_gLog.Write(LOG_FAULT, "failed to couple mount-annex with OBSS[%s:%s]", gid.c_str(), uid.c_str());
-				}
+		else {
+			_gLog.Write(LOG_FAULT, "no settings found for slit[%s]", gid.c_str());
+		}
+	}
+	else {// 当(gid, uid)都不为空时, 投递到观测系统
+		ObsSysPtr obss = find_obss(gid, uid);
+		if (obss.use_count()) {
+			int mode;
+			if ((mode = obss->CoupleMountAnnex(client, base))) {// P2P或P2H模式
+				if (mode == MODE_P2P) erase_coupled_tcp(client);
+				success = true;
 			}
 			else {
-				_gLog.Write(LOG_FAULT, "no OBSS[%s:%s] found for mount-annex", gid.c_str(), uid.c_str());
+				_gLog.Write(LOG_FAULT, "failed to couple mount-annex with OBSS[%s:%s]", gid.c_str(), uid.c_str());
 			}
 		}
+		else {
+			_gLog.Write(LOG_FAULT, "no OBSS[%s:%s] found for mount-annex", gid.c_str(), uid.c_str());
+		}
 	}
 	if (!success) client->Close();
 }
 
-void GeneralControl::resolve_kv_camera_annex(const TcpCPtr client) {
-	kvbase base = kvProto_->ResolveCameraAnnex(bufTcp_.get());
+void GeneralControl::process_kv_camera_annex(const TcpCPtr client, kvbase base) {
 	bool success(false);
-	if (!base.unique()) {
-		_gLog.Write(LOG_FAULT, "unknown protocol from camera-annex: [%s]", bufTcp_.get());
+	// kv协议的相机连接耦合到观测系统
+	string gid  = base->gid;
+	string uid  = base->uid;
+	string cid  = base->cid;
+	if (gid.empty() || uid.empty() || cid.empty()) {
+		_gLog.Write(LOG_FAULT, "illegal protocol from camera-annex: [%s gid=%s,uid=%s,cid=%s]",
+				base->type.c_str(), gid.c_str(), uid.c_str(), cid.c_str());
 	}
 	else {
-		// kv协议的相机连接耦合到观测系统
-		string gid  = base->gid;
-		string uid  = base->uid;
-		string cid  = base->cid;
-		if (gid.empty() || uid.empty() || cid.empty()) {
-			_gLog.Write(LOG_FAULT, "illegal protocol from camera-annex: [%s]", bufTcp_.get());
-		}
-		else {
-			ObsSysPtr obss = find_obss(gid, uid);
-			if (obss.use_count()) {
-				int mode;
-				if ((mode = obss->CoupleCameraAnnex(client, base))) {// P2P或P2H模式
-					if (mode == MODE_P2P) erase_coupled_tcp(client);
-					success = true;
-				}
-				else {
-					_gLog.Write(LOG_FAULT, "failed to couple camera-annex[%s] with OBSS[%s:%s]",
-							cid.c_str(), gid.c_str(), uid.c_str());
-				}
+		ObsSysPtr obss = find_obss(gid, uid);
+		if (obss.use_count()) {
+			int mode;
+			if ((mode = obss->CoupleCameraAnnex(client, base))) {// P2P或P2H模式
+				if (mode == MODE_P2P) erase_coupled_tcp(client);
+				success = true;
 			}
 			else {
-				_gLog.Write(LOG_FAULT, "no OBSS[%s:%s] found for camera-annex[%s]",
-						gid.c_str(), uid.c_str(), cid.c_str());
+				_gLog.Write(LOG_FAULT, "failed to couple camera-annex[%s] with OBSS[%s:%s]",
+						cid.c_str(), gid.c_str(), uid.c_str());
 			}
 		}
+		else {
+			_gLog.Write(LOG_FAULT, "no OBSS[%s:%s] found for camera-annex[%s]",
+					gid.c_str(), uid.c_str(), cid.c_str());
+		}
 	}
 	if (!success) client->Close();
 }
@@ -571,7 +629,7 @@ void GeneralControl::process_nonkv_mount_annex(const TcpCPtr client, nonkvbase b
 	bool success(false);
 
 	if (gid.empty()) {
-		_gLog.Write(LOG_FAULT, "illegal protocol from mount-annex: [%s]", bufTcp_.get());
+		_gLog.Write(LOG_FAULT, "illegal protocol from mount-annex: [%s]", type.c_str());
 	}
 	else if (uid.empty()) {
 		if (iequals(type, NONKVTYPE_SLIT)) {
@@ -579,7 +637,7 @@ void GeneralControl::process_nonkv_mount_annex(const TcpCPtr client, nonkvbase b
 			SlitMulPtr slit = find_slit(gid, client, false);
 			if (slit.use_count()) {
 				if (state != slit->state) {// 通知相关观测系统天窗状态
-					_gLog.Write("Slit[%s] is %s", StateSlit::ToString(state));
+					_gLog.Write("Slit[%s] is %s", gid.c_str(), StateSlit::ToString(state));
 					slit->state = state;
 				}
 				MtxLck lck(mtx_obss_);
@@ -597,11 +655,10 @@ void GeneralControl::process_nonkv_mount_annex(const TcpCPtr client, nonkvbase b
 			if (nfEnv.use_count()) {
 				int rain = from_nonkvbase<nonkv_proto_rain>(base)->state;
 				if (nfEnv->rain != rain) {
-					nfEnv->rain = rain;
-
-					MtxLck lck(mtx_nfEnv_);
-					que_nfEnv_.push_back(nfEnv);
-					PostMessage(MSG_ENV_CHANGED);
+					nfEnv->rain    = rain;
+					nfEnv->arrival = base->arrival;
+					// 已在消息响应线程中经安全通道处理. 不再投递: 队列已满时投递将等待本线程自身
+					check_env(nfEnv);
 				}
 				success = true;
 			}
@@ -730,6 +787,7 @@ ObsSysPtr GeneralControl::find_obss(const string& gid, const string& uid) {
 				obss->RegisterAcquirePlan(slot);
 				obss->SetParameter(param);
 				obss->SetDBPtr(dbPtr_);
+				obss->SetMulticast(mcast_);
 				obss_.push_back(obss);
 
 				NfEnvPtr nfEnv = find_info_env(param);	// 检查并创建新的环境信息
@@ -746,20 +804,25 @@ ObsSysPtr GeneralControl::find_obss(const string& gid, const string& uid) {
 }
 
 SlitMulPtr GeneralControl::find_slit(const string& gid, const TcpCPtr client, bool kvtype) {
-	MtxLck lck(mtx_slit_);
 	SlitMulPtr slit;
-	SlitMulVec::iterator it, itend = slit_.end();
-	for (slit_.begin(); it != itend && !(*it)->IsMatched(gid); ++it);
-	if (it != itend) slit = *it;
-	else if (param_.GetParamOBSS(gid)) {
-		slit = SlitMultiplex::Create(gid);
-		slit->client = client;
-		slit->kvtype = kvtype;
-		slit_.push_back(slit);
-	}
-	else {
-		_gLog.Write(LOG_FAULT, "not found any setting for Slit[%s]", gid.c_str());
+	bool created(false);
+	{
+		MtxLck lck(mtx_slit_);
+		SlitMulVec::iterator it, itend = slit_.end();
+		for (it = slit_.begin(); it != itend && !(*it)->IsMatched(gid); ++it);
+		if (it != itend) slit = *it;
+		else if (param_.GetParamOBSS(gid)) {
+			slit = SlitMultiplex::Create(gid);
+			slit->client = client;
+			slit->kvtype = kvtype;
+			slit_.push_back(slit);
+			created = true;
+		}
+		else {
+			_gLog.Write(LOG_FAULT, "not found any setting for Slit[%s]", gid.c_str());
+		}
 	}
+	if (created) secure_slit(slit);	// 在mtx_slit_外访问环境信息: 与thread_time()的加锁顺序一致
 
 	return slit;
 }
@@ -796,7 +859,26 @@ void GeneralControl::command_slit(const SlitMulPtr slit, int cmd) {
 	const char* s;
 	if (slit->kvtype) s = kvProto_->CompactSlit(slit->gid, "", cmd, n);
 	else s = nonkvProto_->CompactSlit(slit->gid, "", cmd, n);
-	slit->client->Write(s, n);
+	slit->client->Write(s, n, TCPMSG_COMMAND);
+}
+
+void GeneralControl::secure_slit(const SlitMulPtr slit) {
+	const OBSSParam* param = param_.GetParamOBSS(slit->gid);
+	if (!(param && param->useDomeSlit)) return;
+
+	NfEnvPtr nfEnv;
+	{
+		MtxLck lck(mtx_nfEnv_);
+		NfEnvVec::iterator it, itend = nfEnv_.end();
+		for (it = nfEnv_.begin(); it != itend && (*it)->gid != slit->gid; ++it);
+		if (it != itend) nfEnv = *it;
+	}
+	// 仅当收到过气象数据且判定为不安全时关闭. 尚无数据时保持原有行为
+	if (nfEnv.use_count() && nfEnv->arrival && !nfEnv->safe) {
+		_gLog.Write(LOG_WARN, "Slit[%s] registered while Environment is dangerous, commanded to close",
+				slit->gid.c_str());
+		command_slit(slit, CommandSlit::SLITC_CLOSE);
+	}
 }
 
 /*----------------- 环境信息 -----------------*/
@@ -826,23 +908,139 @@ GeneralControl::NfEnvPtr GeneralControl::find_info_env(const OBSSParam* param) {
 //////////////////////////////////////////////////////////////////////////////
 /*----------------- 多线程 -----------------*/
 /* 处理网络事件 */
-void GeneralControl::thread_clean_tcp() {
-	boost::chrono::minutes period(1);
+void GeneralControl::thread_supervise() {
+	boost::chrono::milliseconds period(wheel_.Tick());
+	int ticks(0), ticks_report(TCP_SUPERVISE_PERIOD / wheel_.Tick());
+	int ticks_stat(0), ticks_stat_report(TCP_STAT_PERIOD / wheel_.Tick());
+	int count_last(0), memory_last(0);
+	uint64_t detected_last(0), mismatch_last(0), coalesced_last(0);
+	TimerWheel::TimerVec expired;
 
 	while (1) {
 		boost::this_thread::sleep_for(period);
-		// 清理已关闭的网络连接
-		MtxLck lck1(mtx_tcpC_buff_);
-		for (TcpCVec::iterator it = tcpC_buff_.begin(); it != tcpC_buff_.end(); ) {
-			if ((*it)->IsOpen()) ++it;
-			else it = tcpC_buff_.erase(it);
+		wheel_.Advance(expired);
+		for (TimerWheel::TimerVec::iterator it = expired.begin(); it != expired.end(); ++it)
+			supervise_tcp(boost::static_pointer_cast<TcpSupervise>(*it));
+		expired.clear();
+
+		if (statRequest_.exchange(false)) report_tcp(true);
+		else if (++ticks_stat >= ticks_stat_report) {
+			ticks_stat = 0;
+			report_tcp(false);
 		}
-		// 清理已关闭的多模天窗
-		MtxLck lck2(mtx_slit_);
-		for (SlitMulVec::iterator it = slit_.begin(); it != slit_.end(); ) {
-			if ((*it)->IsOpen()) ++it;
-			else it = slit_.erase(it);
+		if (++ticks >= ticks_report) {
+			ticks = 0;
+			if (tcpCount_ != count_last || tcpMemory_ != memory_last) {
+				_gLog.Write("%d network connection(s) use %d KB memory", tcpCount_, (tcpMemory_ + 1023) / 1024);
+				count_last  = tcpCount_;
+				memory_last = tcpMemory_;
+			}
+			uint64_t kv(statCodec_.kv), nonkv(statCodec_.nonkv), mismatch(statCodec_.mismatch);
+			if (kv + nonkv != detected_last || mismatch != mismatch_last) {
+				_gLog.Write("protocol detected on %llu connection(s): kv %llu, non-kv %llu, %.1f us/detection; mismatched lines: %llu",
+						(unsigned long long) (kv + nonkv), (unsigned long long) kv, (unsigned long long) nonkv,
+						statCodec_.detectNs * 1E-3 / (kv + nonkv), (unsigned long long) mismatch);
+				detected_last = kv + nonkv;
+				mismatch_last = mismatch;
+			}
+			uint64_t coalesced(CoalescedCount());
+			{
+				MtxLck lck(mtx_obss_);
+				for (OBSSVec::iterator it = obss_.begin(); it != obss_.end(); ++it)
+					coalesced += (*it)->CoalescedCount();
+			}
+			if (coalesced != coalesced_last) {
+				_gLog.Write("%llu status message(s) are replaced by newer ones before being processed",
+						(unsigned long long) coalesced);
+				coalesced_last = coalesced;
+			}
+		}
+	}
+}
+
+bool GeneralControl::supervise_tcp(const TcpSvPtr sv) {
+	TcpCPtr client = sv->client.lock();
+	int timeout = sv->timeout;
+	int idle(0), next;
+
+	if (client.use_count() && client->IsOpen()) idle = client->IdleTime();
+	else client.reset();
+	if (client.use_count() && timeout > 0 && idle >= timeout) {// 超时: 由接收流程清理连接
+		_gLog.Write(LOG_WARN, "%s was idle for %d seconds, close it", TypePeer::ToString(sv->peer), idle / 1000);
+		client->Close();
+		client.reset();
+	}
+	if (client.use_count() && sv->peer == PEER_CLIENT) {// 客户端不读取数据: 避免其发送队列占用资源
+		TcpStat stat = client->GetStat();
+		if (stat.blockedMs >= TCP_BLOCK_MAX) {
+			_gLog.Write(LOG_WARN, "client<%s> blocked sending for %d seconds with %d bytes queued, close it",
+					client->PeerName().c_str(), stat.blockedMs / 1000, stat.depth);
+			client->Close();
+			client.reset();
+		}
+	}
+	if (!client.use_count()) {// 连接已关闭
+		if (sv->counted) {
+			--tcpCount_;
+			tcpMemory_ -= sv->memory;
+		}
+		MtxLck lck(mtx_tcpSv_);
+		TcpSvVec::iterator it = std::find(tcpSv_.begin(), tcpSv_.end(), sv);
+		if (it != tcpSv_.end()) {
+			*it = tcpSv_.back();
+			tcpSv_.pop_back();
+		}
+		return false;
+	}
+
+	if (timeout > 0 && idle >= timeout / 2) {// 空闲超过一半: 探测对方是否在线
+		if (!sv->probed) sv->probed = client->Probe(1, (timeout - idle) / 1000);
+		next = timeout - idle;
+	}
+	else next = timeout > 0 ? timeout / 2 - idle : TCP_SUPERVISE_PERIOD;
+	if (idle >= TCP_TRIM_IDLE) client->ShrinkBuffer();
+	// 占用内存
+	int mem = client->MemoryUsage();
+	if (!sv->counted) {
+		sv->counted = true;
+		++tcpCount_;
+	}
+	tcpMemory_ += mem - sv->memory;
+	sv->memory = mem;
+
+	wheel_.Schedule(sv, next);
+	return true;
+}
+
+void GeneralControl::report_tcp(bool all) {
+	TcpSvVec svs;
+	{
+		MtxLck lck(mtx_tcpSv_);
+		svs = tcpSv_;
+	}
+	for (TcpSvVec::iterator it = svs.begin(); it != svs.end(); ++it) {
+		TcpSvPtr sv = *it;
+		TcpCPtr client = sv->client.lock();
+		if (!client.use_count() || !client->IsOpen()) continue;
+		TcpStat stat = client->GetStat();
+		if (!all && stat.msgIn == sv->msgIn && stat.msgOut == sv->msgOut && !stat.depth) continue;
+		sv->msgIn  = stat.msgIn;
+		sv->msgOut = stat.msgOut;
+
+		string rtt;
+		if (stat.rttCount) {
+			char buff[64];
+			sprintf(buff, "; rtt avg %.2f max %.2f ms", stat.rttUs * 1E-3 / stat.rttCount, stat.rttMaxUs * 1E-3);
+			rtt = buff;
 		}
+		_gLog.Write("%s<%s> in %llu lines/%llu bytes, out %llu msgs/%llu bytes; queue %d msgs/%d bytes, peak %d bytes; "
+				"write wait %.1f ms total, max %.2f ms, blocked %d ms; dropped %llu bytes, overwritten %llu bytes%s",
+				TypePeer::ToString(sv->peer), client->PeerName().c_str(),
+				(unsigned long long) stat.msgIn, (unsigned long long) stat.bytesIn,
+				(unsigned long long) stat.msgOut, (unsigned long long) stat.bytesOut,
+				stat.depthMsg, stat.depth, stat.depthMax,
+				stat.writeUs * 1E-3, stat.writeMaxUs * 1E-3, stat.blockedMs,
+				(unsigned long long) stat.bytesDropped, (unsigned long long) stat.bytesCoalesced, rtt.c_str());
 	}
 }
 
@@ -9,13 +9,26 @@
  * @version 1.0
  * @date 2020-07-05
  * - 观测系统建立后生命周期同主程序. 每日按照活跃度降序排序
+ * @version 1.1
+ * @date 2026-10-16
+ * - 以时间轮监视网络连接: 只处理到期连接, 不再周期扫描所有连接
+ * - 空闲超过超时时间一半时由系统探测对方是否在线; 超时后关闭连接
+ * - 各类主机可在本地(AF_UNIX)套接口上连接
+ * - 可选: 以UDP组播发布转台、相机与观测系统实时状态
+ * - 网络信息在连接所属I/O线程中分解与解析, 消息队列只处理解析后的协议
+ * - 每个网络连接由首条信息识别协议格式并绑定编解码器, 识别统计定期输出
+ * - 定期或收到SIGUSR1时输出网络连接收发统计; 关闭发送长时间阻塞的客户端
+ * - 网络事件与环境信息随消息投递, 不再经由另行加锁的队列
+ * - 设备实时状态可合并: 同一设备(类型与gid:uid:cid)未处理的状态由最新状态替换. 合并数量定期输出
+ * - 气象信息、降水报警与客户端天窗指令经消息队列安全通道处理. 记录从数据包到达至发出关闭天窗指令的延迟
+ * - 消息响应线程直接判定降水报警, 不向自身的消息队列投递: 队列已满时投递将永久阻塞
  */
 
 #ifndef GENERALCONTROL_H_
 #define GENERALCONTROL_H_
 
 #include <vector>
-#include <deque>
+#include <atomic>
 #include "MessageQueue.h"
 #include "Parameter.h"
 #include "NTPClient.h"
@@ -27,6 +40,8 @@
 #include "NonkvProtocol.h"
 #include "ObservationPlan.h"
 #include "TcpReceived.h"
+#include "ProtocolCodec.h"
+#include "TimerWheel.h"
 
 //////////////////////////////////////////////////////////////////////////////
 class GeneralControl : public MessageQueue {
@@ -37,6 +52,41 @@ public:
 
 /* 数据结构 */
 protected:
+	/*!
+	 * @struct TcpSupervise
+	 * @brief 网络连接监视记录
+	 */
+	struct TcpSupervise : public TimerWheel::Timer {
+		using Pointer = boost::shared_ptr<TcpSupervise>;
+
+		boost::weak_ptr<TcpClient> client;	///< 网络连接
+		int peer;		///< 主机类型
+		int timeout;	///< 空闲超时, 量纲: 毫秒. <= 0时不检查
+		bool probed;	///< 已启动在线探测
+		bool counted;	///< 已计入内存统计
+		int memory;		///< 最后统计的占用内存, 量纲: 字节
+		uint64_t msgIn;		///< 最后输出统计时的接收信息数量
+		uint64_t msgOut;	///< 最后输出统计时的发送信息数量
+
+	public:
+		TcpSupervise(const TcpCPtr _client, int _peer, int _timeout)
+			: client(_client) {
+			peer    = _peer;
+			timeout = _timeout;
+			probed  = false;
+			counted = false;
+			memory  = 0;
+			msgIn   = 0;
+			msgOut  = 0;
+		}
+
+		static Pointer Create(const TcpCPtr client, int peer, int timeout) {
+			return Pointer(new TcpSupervise(client, peer, timeout));
+		}
+	};
+	using TcpSvPtr = TcpSupervise::Pointer;
+	using TcpSvVec = std::vector<TcpSvPtr>;
+
 	/*!
 	 * @struct EnvInfo
 	 * @brief 环境信息
@@ -52,6 +102,7 @@ protected:
 		int orient;	///< 风向
 		int speed;	///< 风速
 		int cloud;	///< 云量
+		int64_t arrival;	///< 最近一次改变气象条件的数据包的到达时间, 自1970-01-01起的纳秒数
 		/* 时间 */
 		int odt;	///< 观测时间类型
 
@@ -63,6 +114,7 @@ protected:
 			rain   = -1;
 			orient = speed = -1;
 			cloud  = -1;
+			arrival= 0;
 			odt    = -1;
 		}
 
@@ -72,14 +124,13 @@ protected:
 	};
 	using NfEnvPtr = EnvInfo::Pointer;
 	using NfEnvVec = std::vector<NfEnvPtr>;
-	using NfEnvQue = std::deque<NfEnvPtr>;
 
 /* 成员变量 */
 protected:
 	//////////////////////////////////////////////////////////////////////////////
 	enum {
 		MSG_TCP_RECEIVE = MSG_USER,///< 收到TCP消息
-		MSG_ENV_CHANGED	///< 气象信息改变的响应
+		MSG_ENV_RECEIVE	///< 收到气象信息数据包
 	};
 
 	//////////////////////////////////////////////////////////////////////////////
@@ -87,25 +138,28 @@ protected:
 	NTPPtr ntp_;
 
 	/* 网络资源 */
-	TcpSPtr	tcpS_client_;		///< 网络服务: 客户端
-	TcpSPtr tcpS_mount_;		///< 网络服务: 转台
-	TcpSPtr tcpS_camera_;		///< 网络服务: 相机
-	TcpSPtr tcpS_mountAnnex_;	///< 网络服务: 转台附属
-	TcpSPtr tcpS_cameraAnnex_;	///< 网络服务: 相机附属
+	TcpAcpPtr tcpAcceptor_;		///< 网络服务: 客户端、转台、相机、转台附属与相机附属. 按端口标记主机类型
 
 	UdpPtr  udpS_env_;			///< 网络服务: 气象环境, UDP
-	boost::shared_array<char> bufUdp_;	///< 网络信息存储区: 消息队列中调用
+	UdpPktVec pktEnv_;			///< 批量取出的气象信息数据包: 消息队列中调用
+	std::atomic<bool> envPending_;	///< 已投递MSG_ENV_RECEIVE且尚未处理. 投递可能阻塞, 不在锁内访问
+	uint64_t envDropped_;		///< 已报告的被覆盖数据包数量
+	double safetyLatencyMax_;	///< 关闭天窗指令的最大延迟, 量纲: 毫秒. 消息队列中访问
 
 	TcpCVec tcpC_buff_;			///< 网络连接
 	boost::mutex mtx_tcpC_buff_;///< 互斥锁: 网络连接
-	ThreadPtr thrd_tcpClean_;	///< 线程: 释放已关闭的网络连接
-
-	TcpRcvQue que_tcpRcv_;		///< 网络事件队列
-	boost::mutex mtx_tcpRcv_;	///< 互斥锁: 网络事件
+	TimerWheel wheel_;			///< 时间轮: 监视网络连接
+	int timeoutPeer_[PEER_LAST];///< 各类主机的空闲超时, 量纲: 毫秒
+	int tcpCount_;				///< 被监视的网络连接数量
+	int tcpMemory_;				///< 被监视的网络连接占用内存, 量纲: 字节
+	TcpSvVec tcpSv_;			///< 被监视的网络连接, 用于输出统计
+	boost::mutex mtx_tcpSv_;	///< 互斥锁: 被监视的网络连接
+	std::atomic<bool> statRequest_;	///< 已申请输出所有网络连接的统计
+	ThreadPtr thrd_supervise_;	///< 线程: 推进时间轮, 处理到期的网络连接
 
-	boost::shared_array<char> bufTcp_;	///< 网络信息存储区: 消息队列中调用
-	KvProtoPtr kvProto_;		///< 键值对格式协议访问接口
+	KvProtoPtr kvProto_;		///< 键值对格式协议访问接口. 解析在I/O线程中调用
 	NonkvProtoPtr nonkvProto_;	///< 非键值对格式协议访问接口
+	CodecStat statCodec_;		///< 协议识别统计
 
 	/* 观测计划 */
 	ObsPlanPtr obsPlans_;		///< 观测计划集合
@@ -122,12 +176,14 @@ protected:
 
 	/* 环境信息 */
 	NfEnvVec nfEnv_;	///< 环境信息: 在线信息集合
-	NfEnvQue que_nfEnv_;	///< 环境信息队列: 信息改变
 	boost::mutex mtx_nfEnv_;	///< 互斥锁: 环境信息
 
 	/* 数据库 */
 	DBCurlPtr dbPtr_;	///< 数据库访问接口
 
+	/* 状态组播 */
+	McastPtr mcast_;	///< 实时状态组播接口
+
 	/* 观测时间类型 */
 	ThreadPtr thrd_odt_;	///< 线程: 计算观测系统所处的观测时间类型
 	ThreadPtr thrd_noon_;	///< 线程: 每天中午清理无效的资源
@@ -145,6 +201,12 @@ public:
 	 * @brief 停止服务
 	 */
 	void Stop();
+	/*!
+	 * @brief 申请输出所有网络连接的收发统计
+	 * @note
+	 * 可在任意线程或信号处理中调用. 由监视线程在下一个节拍输出
+	 */
+	void ReportNetwork();
 
 /* 功能 */
 protected:
@@ -155,16 +217,24 @@ protected:
 	void register_messages();
 	/*!
 	 * @brief 消息: 收到TCP信息
-	 * @param par1  参数1, 保留
-	 * @param par2  参数2, 保留
+	 * @param par1     参数1, 保留
+	 * @param par2     参数2, 保留
+	 * @param payload  网络事件, TcpRcvPtr
 	 */
-	void on_tcp_receive(const long par1, const long par2);
+	void on_tcp_receive(const long par1, const long par2, MessagePayload& payload);
 	/*!
-	 * @brief 响应气象信息改变
+	 * @brief 批量处理收到的气象信息数据包
 	 * @param par1  保留
 	 * @param par2  保留
+	 * @note
+	 * 同一环境信息在一批数据包中多次改变时只判定一次
+	 */
+	void on_env_receive(const long par1, const long par2);
+	/*!
+	 * @brief 依据环境信息判定安全性, 并控制天窗
+	 * @param nfEnv  环境信息
 	 */
-	void on_env_changed(const long par1, const long par2);
+	void check_env(const NfEnvPtr nfEnv);
 	/*!
 	 * @brief 处理客户端信息
 	 * @param client 网络连接
@@ -172,28 +242,34 @@ protected:
 	 * @param peer   远程主机类型
 	 */
 	void receive_from_peer(const TcpCPtr client, const error_code& ec, int peer);
+	/*!
+	 * @brief 在I/O线程中解析一条网络信息, 并投递解析结果
+	 * @param client 网络连接
+	 * @param line   信息. 不含换行符, 以0结尾
+	 * @param n      信息长度
+	 * @param codec  连接绑定的编解码器
+	 * @param status 连接绑定的暂存单元集合, 按设备合并实时状态
+	 */
+	void parse_from_peer(const TcpCPtr client, char* line, int n, const CodecPtr codec,
+			const SlotGroupPtr status);
 
 protected:
 	/*----------------- 网络服务 -----------------*/
 	/*!
-	 * @brief 创建网络服务
-	 * @param server 网络服务
-	 * @param port   监听端口
+	 * @brief 为一类主机创建网络服务
+	 * @param port  TCP服务端口. <= 0时不使用TCP
+	 * @param path  本地套接口路径. 为空时不使用本地套接口
+	 * @param peer  主机类型
 	 * @return
 	 * 创建结果
 	 */
-	bool create_server(TcpSPtr *server, const uint16_t port);
+	bool create_server(int port, const string& path, int peer);
 	/*!
 	 * @brief 依据配置文件, 创建所有网络服务
 	 * @return
 	 * 创建结果
 	 */
 	bool create_all_server();
-	/*!
-	 * @brief 关闭网络服务
-	 * @param server  网络服务
-	 */
-	void close_server(TcpSPtr& server);
 	/*!
 	 * @brief 关闭所有网络服务
 	 */
@@ -201,13 +277,23 @@ protected:
 	/*!
 	 * @brief 处理网络连接请求
 	 * @param client 为连接请求分配额网络资源
-	 * @param server 服务器标识
+	 * @param peer   主机类型. 由监听端口确定
 	 */
-	void network_accept(const TcpCPtr client, const TcpSPtr server);
+	void network_accept(const TcpCPtr client, int peer);
 	/*!
 	 * @brief 处理环境监测信息
+	 * @note
+	 * 在I/O线程中调用. 投递消息, 由消息队列批量解析
 	 */
 	void receive_from_env(const UdpPtr client, const error_code& ec);
+	/*!
+	 * @brief 解析一条气象信息, 并更新环境信息
+	 * @param rcvd     气象信息
+	 * @param arrival  数据包到达时间
+	 * @return
+	 * 发生改变的环境信息. 未改变时为空
+	 */
+	NfEnvPtr resolve_env(const char* rcvd, int64_t arrival);
 	/*!
 	 * @brief 从网络资源存储区里移除指定连接, 该连接已关联观测系统
 	 * @param client  网络连接
@@ -223,36 +309,30 @@ protected:
 protected:
 	/*----------------- 解析/执行通信协议 -----------------*/
 	/*!
-	 * @brief 解析与用户/数据库、通用望远镜、相机、制冷(GWAC)、真空(GWAC)相关网络信息
-	 * @param client 网络资源
-	 * @param peer   远程主机类型
-	 */
-	void resolve_from_peer(const TcpCPtr client, int peer);
-	/*!
-	 * @brief  解析处理客户端的键值对协议
-	 * @param client  网络连接
-	 */
-	void resolve_kv_client(const TcpCPtr client);
-	/*!
-	 * @brief  解析处理转台的键值对协议
-	 * @param client  网络连接
-	 */
-	void resolve_kv_mount(const TcpCPtr client);
-	/*!
-	 * @brief  解析处理相机的键值对协议
-	 * @param client  网络连接
-	 */
-	void resolve_kv_camera(const TcpCPtr client);
-	/*!
-	 * @brief  解析处理转台附属设备的键值对协议
-	 * @param client  网络连接
-	 */
-	void resolve_kv_mount_annex (const TcpCPtr client);
-	/*!
-	 * @brief  解析处理相机附属设备的键值对协议
+	 * @brief 处理与用户/数据库、通用望远镜、相机、制冷(GWAC)、真空(GWAC)相关网络信息
+	 * @param rcvd   已解析的网络信息
+	 */
+	void resolve_from_peer(const TcpRcvPtr rcvd);
+	/*!
+	 * @fn process_kv_client
+	 * @brief   处理客户端的键值对协议
+	 * @fn process_kv_mount
+	 * @brief   处理转台的键值对协议
+	 * @fn process_kv_camera
+	 * @brief   处理相机的键值对协议
+	 * @fn process_kv_mount_annex
+	 * @brief   处理转台附属设备的键值对协议
+	 * @fn process_kv_camera_annex
+	 * @brief   处理相机附属设备的键值对协议
+	 *
 	 * @param client  网络连接
+	 * @param base    通信协议
 	 */
-	void resolve_kv_camera_annex(const TcpCPtr client);
+	void process_kv_client      (const TcpCPtr client, kvbase base);
+	void process_kv_mount       (const TcpCPtr client, kvbase base);
+	void process_kv_camera      (const TcpCPtr client, kvbase base);
+	void process_kv_mount_annex (const TcpCPtr client, kvbase base);
+	void process_kv_camera_annex(const TcpCPtr client, kvbase base);
 
 	/*!
 	 * @fn process_nonkv_mount
@@ -329,6 +409,13 @@ protected:
 	 * @param cmd   控制指令
 	 */
 	void command_slit(const SlitMulPtr slit, int cmd);
+	/*!
+	 * @brief 新注册的天窗: 环境已判定为不安全时补发关闭指令
+	 * @param slit  多模天窗
+	 * @note
+	 * 降水报警可能先于同一连接已排队的天窗注册信息处理, 此时check_env()的关闭指令无处投递
+	 */
+	void secure_slit(const SlitMulPtr slit);
 
 protected:
 	/*----------------- 环境信息 -----------------*/
@@ -350,9 +437,28 @@ protected:
 protected:
 	/*----------------- 多线程 -----------------*/
 	/*!
-	 * @brief 集中清理已断开的网络连接
+	 * @brief 推进时间轮, 处理到期的网络连接
+	 * @note
+	 * 定期输出网络连接占用内存与收发统计
+	 */
+	void thread_supervise();
+	/*!
+	 * @brief 输出网络连接收发统计
+	 * @param all  true: 所有网络连接; false: 上次输出后有收发的网络连接
+	 */
+	void report_tcp(bool all);
+	/*!
+	 * @brief 处理到期的网络连接
+	 * @param sv  网络连接监视记录
+	 * @return
+	 * 是否继续监视
+	 * @note
+	 * - 到期前接收过数据时, 按最后接收数据时间重新加入时间轮
+	 * - 空闲超过超时时间一半时启动在线探测, 超时后关闭连接
+	 * - 空闲连接收缩接收缓冲区
+	 * - 客户端发送阻塞超过TCP_BLOCK_MAX时关闭连接
 	 */
-	void thread_clean_tcp();
+	bool supervise_tcp(const TcpSvPtr sv);
 	/*!
 	 * @brief 计算观测时间类型
 	 * @note
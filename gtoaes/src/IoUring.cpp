@@ -0,0 +1,347 @@
+/**
+ * @file IoUring.cpp
+ * @brief 基于io_uring的网络接收服务
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#ifdef USE_IO_URING
+
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+#include <boost/bind/bind.hpp>
+#include <boost/asio/post.hpp>
+#include "IoUring.h"
+
+using namespace boost::placeholders;
+using boost::system::error_code;
+
+boost::asio::execution_context::id IoUringService::id;
+
+IoUringService::IoUringService(IOService& ios)
+	: boost::asio::execution_context::service(ios)
+	, ios_(ios)
+	, evfd_(ios) {
+	fd_ = efd_ = -1;
+	sq_ptr_ = cq_ptr_ = NULL;
+	sq_len_ = cq_len_ = sqes_len_ = br_len_ = 0;
+	sq_head_ = sq_tail_ = sq_array_ = cq_head_ = cq_tail_ = NULL;
+	sq_mask_ = sq_entries_ = cq_mask_ = pending_ = 0;
+	sqes_ = NULL;
+	cqes_ = NULL;
+	br_   = NULL;
+	bufs_ = NULL;
+	br_tail_ = 0;
+	next_key_ = 1;
+	multishot_ = true;
+	enters_ = wakeups_ = cqes_total_ = 0;
+
+	if (!setup()) release();
+	else start_wait();
+}
+
+IoUringService::~IoUringService() {
+	release();
+}
+
+uint64_t IoUringService::Receive(int fd, const RecvFunc& func) {
+	uint64_t key = next_key_++;
+	{
+		MtxLck lck(mtx_);
+		Receiver& r = recv_[key];
+		r.fd = fd;
+		r.func = func;
+		r.cancelled = false;
+	}
+	boost::asio::post(ios_, boost::bind(&IoUringService::do_arm, this, key));
+	return key;
+}
+
+void IoUringService::Cancel(uint64_t key) {
+	{
+		MtxLck lck(mtx_);
+		RecvMap::iterator it = recv_.find(key);
+		if (it == recv_.end() || it->second.cancelled) return;
+		it->second.cancelled = true;
+	}
+	boost::asio::post(ios_, boost::bind(&IoUringService::do_cancel, this, key));
+}
+
+void IoUringService::GetStat(uint64_t& enters, uint64_t& wakeups, uint64_t& cqes) {
+	MtxLck lck(mtx_);
+	enters  = enters_;
+	wakeups = wakeups_;
+	cqes    = cqes_total_;
+}
+
+void IoUringService::shutdown() {
+	error_code ec;
+	evfd_.close(ec);
+	efd_ = -1;
+	RecvMap recv;
+	{// 释放回调函数绑定的对象. 不再调用回调函数
+		MtxLck lck(mtx_);
+		recv.swap(recv_);
+	}
+	recv.clear();
+	release();
+}
+
+bool IoUringService::setup() {
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	fd_ = syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+	if (fd_ < 0) return false;
+
+	// 映射提交队列与完成队列
+	bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+	sq_len_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cq_len_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	if (single && cq_len_ > sq_len_) sq_len_ = cq_len_;
+	sq_ptr_ = mmap(NULL, sq_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+	if (sq_ptr_ == MAP_FAILED) {
+		sq_ptr_ = NULL;
+		return false;
+	}
+	if (single) cq_ptr_ = sq_ptr_;
+	else {
+		cq_ptr_ = mmap(NULL, cq_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+		if (cq_ptr_ == MAP_FAILED) {
+			cq_ptr_ = NULL;
+			return false;
+		}
+	}
+	sqes_len_ = params.sq_entries * sizeof(io_uring_sqe);
+	sqes_ = (io_uring_sqe*) mmap(NULL, sqes_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+	if (sqes_ == MAP_FAILED) {
+		sqes_ = NULL;
+		return false;
+	}
+
+	char* sq = (char*) sq_ptr_;
+	sq_head_    = (unsigned*) (sq + params.sq_off.head);
+	sq_tail_    = (unsigned*) (sq + params.sq_off.tail);
+	sq_array_   = (unsigned*) (sq + params.sq_off.array);
+	sq_mask_    = *(unsigned*) (sq + params.sq_off.ring_mask);
+	sq_entries_ = *(unsigned*) (sq + params.sq_off.ring_entries);
+	char* cq = (char*) cq_ptr_;
+	cq_head_ = (unsigned*) (cq + params.cq_off.head);
+	cq_tail_ = (unsigned*) (cq + params.cq_off.tail);
+	cq_mask_ = *(unsigned*) (cq + params.cq_off.ring_mask);
+	cqes_    = (io_uring_cqe*) (cq + params.cq_off.cqes);
+
+	// 注册缓冲区环
+	br_len_ = URING_BUF_COUNT * sizeof(io_uring_buf);
+	void* ptr = mmap(NULL, br_len_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ptr == MAP_FAILED) return false;
+	br_   = (io_uring_buf_ring*) ptr;
+	bufs_ = new char[URING_BUF_COUNT * URING_BUF_SIZE];
+
+	io_uring_buf_reg reg;
+	memset(&reg, 0, sizeof(reg));
+	reg.ring_addr    = (uint64_t) br_;
+	reg.ring_entries = URING_BUF_COUNT;
+	reg.bgid         = URING_BUF_GROUP;
+	if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) return false;
+	for (unsigned short bid = 0; bid < URING_BUF_COUNT; ++bid) recycle(bid);
+
+	// 完成事件通知
+	if ((efd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) return false;
+	if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_EVENTFD, &efd_, 1) < 0) return false;
+	error_code ec;
+	evfd_.assign(efd_, ec);
+	return !ec;
+}
+
+void IoUringService::release() {
+	if (efd_ >= 0) {
+		error_code ec;
+		if (evfd_.is_open()) evfd_.close(ec);
+		else close(efd_);
+		efd_ = -1;
+	}
+	if (sqes_) {
+		munmap(sqes_, sqes_len_);
+		sqes_ = NULL;
+	}
+	if (cq_ptr_ && cq_ptr_ != sq_ptr_) munmap(cq_ptr_, cq_len_);
+	cq_ptr_ = NULL;
+	if (sq_ptr_) {
+		munmap(sq_ptr_, sq_len_);
+		sq_ptr_ = NULL;
+	}
+	if (fd_ >= 0) {// 先关闭io_uring, 内核不再写入注册缓冲区
+		close(fd_);
+		fd_ = -1;
+	}
+	if (br_) {
+		munmap(br_, br_len_);
+		br_ = NULL;
+	}
+	if (bufs_) {
+		delete []bufs_;
+		bufs_ = NULL;
+	}
+}
+
+io_uring_sqe* IoUringService::get_sqe() {
+	unsigned tail = *sq_tail_;
+	if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) {
+		submit();
+		if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) return NULL;
+	}
+	// 未启用SQPOLL: 内核只在io_uring_enter中读取提交队列项, 可以先移动尾部再填写
+	unsigned idx = tail & sq_mask_;
+	io_uring_sqe* sqe = &sqes_[idx];
+	memset(sqe, 0, sizeof(io_uring_sqe));
+	sq_array_[idx] = idx;
+	__atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+	++pending_;
+	return sqe;
+}
+
+void IoUringService::submit() {
+	if (!pending_) return;
+	int n = syscall(__NR_io_uring_enter, fd_, pending_, 0, 0, NULL, 0);
+	++enters_;
+	if (n > 0) pending_ -= n > (int) pending_ ? pending_ : n;
+}
+
+void IoUringService::recycle(unsigned short bid) {
+	// 不使用br_->bufs: C++中空结构体占1字节, 内核头文件中bufs的偏移量与C不同
+	io_uring_buf* buf = (io_uring_buf*) br_ + (br_tail_ & (URING_BUF_COUNT - 1));
+	buf->addr = (uint64_t) (bufs_ + bid * URING_BUF_SIZE);
+	buf->len  = URING_BUF_SIZE;
+	buf->bid  = bid;
+	__atomic_store_n(&br_->tail, ++br_tail_, __ATOMIC_RELEASE);
+}
+
+void IoUringService::arm(uint64_t key, int fd) {
+	io_uring_sqe* sqe = get_sqe();
+	if (!sqe) {// 提交队列持续满载: 以错误结束接收
+		io_uring_cqe cqe;
+		memset(&cqe, 0, sizeof(cqe));
+		cqe.user_data = key;
+		cqe.res = -EBUSY;
+		complete(cqe);
+		return;
+	}
+	sqe->opcode    = IORING_OP_RECV;
+	sqe->fd        = fd;
+	sqe->ioprio    = IORING_RECV_MULTISHOT;
+	sqe->flags     = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = URING_BUF_GROUP;
+	sqe->user_data = key;
+	submit();
+}
+
+void IoUringService::do_arm(uint64_t key) {
+	if (fd_ < 0) return;
+
+	RecvFunc func;
+	int fd(-1);
+	{
+		MtxLck lck(mtx_);
+		RecvMap::iterator it = recv_.find(key);
+		if (it == recv_.end()) return;
+		if (!it->second.cancelled) fd = it->second.fd;
+		else {// 提交前已被取消
+			func = it->second.func;
+			recv_.erase(it);
+		}
+	}
+	if (func) func(NULL, -ECANCELED);
+	else arm(key, fd);
+}
+
+void IoUringService::do_cancel(uint64_t key) {
+	if (fd_ < 0) return;
+	io_uring_sqe* sqe = get_sqe();
+	if (sqe) {
+		sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+		sqe->fd        = -1;
+		sqe->addr      = key;
+		sqe->user_data = 0;
+		submit();
+	}
+}
+
+void IoUringService::start_wait() {
+	evfd_.async_wait(boost::asio::posix::stream_descriptor::wait_read,
+			boost::bind(&IoUringService::handle_wait, this, _1));
+}
+
+void IoUringService::handle_wait(const error_code& ec) {
+	if (ec || fd_ < 0) return;
+
+	uint64_t count;
+	if (read(efd_, &count, sizeof(count)) < 0 && errno != EAGAIN) return;
+	{
+		MtxLck lck(mtx_);
+		++wakeups_;
+	}
+	// 处理完成事件. 回调函数中可能提交新的请求, 一并在唤醒结束前提交
+	unsigned head = *cq_head_;
+	unsigned tail;
+	while ((tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) != head) {
+		for (; head != tail; ++head) {
+			io_uring_cqe cqe = cqes_[head & cq_mask_];
+			__atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+			complete(cqe);
+		}
+	}
+	submit();
+	start_wait();
+}
+
+void IoUringService::complete(const io_uring_cqe& cqe) {
+	bool hasbuf = cqe.flags & IORING_CQE_F_BUFFER;
+	bool more   = cqe.flags & IORING_CQE_F_MORE;
+	unsigned short bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+	uint64_t key = cqe.user_data;
+	int res = cqe.res;
+	RecvFunc func;
+	int fd(-1);
+	bool cancelled(false);
+	{
+		MtxLck lck(mtx_);
+		++cqes_total_;
+		RecvMap::iterator it = key ? recv_.find(key) : recv_.end();
+		if (it != recv_.end()) {
+			// 复制回调函数: 回调函数中可能调用Receive()/Cancel()
+			func      = it->second.func;
+			fd        = it->second.fd;
+			cancelled = it->second.cancelled;
+			// 接收结束: 对方关闭、出错或已取消
+			if (!more && (cancelled || (res <= 0 && res != -ENOBUFS))) recv_.erase(it);
+		}
+	}
+	if (!func) {// 取消请求的结果或已结束的接收
+		if (hasbuf) recycle(bid);
+		return;
+	}
+
+	if (res > 0) {
+		if (!cancelled) func(bufs_ + bid * URING_BUF_SIZE, res);
+		if (hasbuf) recycle(bid);
+		if (!more) {
+			if (!cancelled) arm(key, fd);	// 内核结束了multishot接收: 重新提交
+			else func(NULL, -ECANCELED);
+		}
+	}
+	else {
+		if (hasbuf) recycle(bid);
+		if (more) return;
+		if (res == -EINVAL) multishot_ = false;	// 内核不识别IORING_RECV_MULTISHOT
+		if (res == -ENOBUFS && !cancelled) {// 注册缓冲区耗尽: 处理完本批完成事件、归还缓冲区后再重新提交
+			boost::asio::post(ios_, boost::bind(&IoUringService::do_arm, this, key));
+		}
+		else func(NULL, cancelled ? -ECANCELED : res);
+	}
+}
+
+#endif /* USE_IO_URING */
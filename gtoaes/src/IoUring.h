@@ -0,0 +1,202 @@
+/**
+ * @file IoUring.h
+ * @brief 基于io_uring的网络接收服务. 编译时定义USE_IO_URING启用(configure --enable-io-uring)
+ * @version 0.1
+ * @date 2026-10-17
+ * @note
+ * - 作为boost::asio服务附加在io_service上, 每个io_service一个io_uring实例, 在其I/O线程中提交与处理
+ * - 接收使用multishot recv与内核注册的缓冲区环: 一次提交持续接收, 数据由内核写入注册缓冲区
+ * - 完成事件通过eventfd通知io_service. 一次唤醒处理所有连接的完成事件, 接收数据不再逐次调用recv
+ * - 直接调用系统调用, 不依赖liburing
+ * - 内核不支持或禁用io_uring时IsValid()返回false, 调用者回退至epoll
+ * - 内核支持注册缓冲区环而不支持multishot recv(5.19)时, 首个接收以-EINVAL结束.
+ *   此后IsValid()返回false, 调用者对该连接及后续连接回退至epoll
+
+ * - Disable()停用io_uring, 此后启动接收的连接使用epoll. 用于在同一进程中对比两种接收方式
+ */
+
+#ifndef SRC_IOURING_H_
+#define SRC_IOURING_H_
+
+#ifdef USE_IO_URING
+
+#include <stdint.h>
+#include <atomic>
+#include <unordered_map>
+#include <boost/asio/io_service.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/lock_types.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/system/error_code.hpp>
+#include <linux/io_uring.h>
+#include "Delegate.h"
+
+#define URING_ENTRIES		256		///< 提交队列容量
+#define URING_BUF_COUNT		256		///< 注册缓冲区数量. 2的幂
+#define URING_BUF_SIZE		4096	///< 注册缓冲区长度, 量纲: 字节
+#define URING_BUF_GROUP		0		///< 注册缓冲区组编号
+
+class IoUringService : public boost::asio::execution_context::service {
+public:
+	using IOService = boost::asio::io_service;
+	/*!
+	 * @brief 声明接收回调函数
+	 * @param 1 数据首地址. 函数返回后失效
+	 * @param 2 > 0: 数据长度; == 0: 对方关闭连接; < 0: 错误代码的相反数. <= 0时接收结束
+	 */
+	using RecvFunc = Delegate<void (const char*, int)>;
+
+	static boost::asio::execution_context::id id;
+
+protected:
+	/*!
+	 * @struct Receiver
+	 * @brief 已提交的接收
+	 */
+	struct Receiver {
+		int fd;				//< 套接口
+		RecvFunc func;		//< 回调函数
+		bool cancelled;		//< 已申请取消
+	};
+	using RecvMap = std::unordered_map<uint64_t, Receiver>;
+	using MtxLck = boost::unique_lock<boost::mutex>;
+
+protected:
+	/* 成员变量 */
+	IOService& ios_;	//< 所属io_service
+	int fd_;			//< io_uring文件描述符. < 0时无效
+	/* 提交队列 */
+	void* sq_ptr_;		//< 映射地址
+	size_t sq_len_;		//< 映射长度
+	unsigned* sq_head_;
+	unsigned* sq_tail_;
+	unsigned* sq_array_;
+	unsigned sq_mask_;
+	unsigned sq_entries_;
+	io_uring_sqe* sqes_;	//< 提交队列项
+	size_t sqes_len_;
+	unsigned pending_;		//< 未提交的提交队列项数量
+	/* 完成队列 */
+	void* cq_ptr_;		//< 映射地址. 内核支持单次映射时与sq_ptr_相同
+	size_t cq_len_;
+	unsigned* cq_head_;
+	unsigned* cq_tail_;
+	unsigned cq_mask_;
+	io_uring_cqe* cqes_;
+	/* 注册缓冲区 */
+	io_uring_buf_ring* br_;	//< 缓冲区环
+	size_t br_len_;
+	char* bufs_;			//< 缓冲区
+	unsigned short br_tail_;	//< 缓冲区环尾部
+	/* 完成通知 */
+	int efd_;			//< eventfd
+	boost::asio::posix::stream_descriptor evfd_;	//< 在io_service中等待eventfd
+	/* 接收 */
+	RecvMap recv_;		//< 已登记的接收
+	boost::mutex mtx_;	//< 互斥锁: 已登记的接收
+	std::atomic<uint64_t> next_key_;	//< 下一个接收标识. 0保留给取消请求
+	std::atomic<bool> multishot_;		//< 可使用multishot recv. 接收以-EINVAL结束或调用Disable()后置为false
+	/* 统计 */
+	uint64_t enters_;	//< io_uring_enter调用次数
+	uint64_t wakeups_;	//< 被eventfd唤醒次数
+	uint64_t cqes_total_;	//< 处理的完成事件数量
+
+public:
+	explicit IoUringService(IOService& ios);
+	virtual ~IoUringService();
+	/*!
+	 * @brief 检查io_uring是否可用
+	 */
+	bool IsValid() const {
+		return fd_ >= 0 && multishot_;
+	}
+	/*!
+	 * @brief 停用io_uring. 此后IsValid()返回false, 调用者对新启动的接收回退至epoll
+	 * @note
+	 * 不影响已启动的接收
+	 */
+	void Disable() {
+		multishot_ = false;
+	}
+	/*!
+	 * @brief 在套接口上启动持续接收
+	 * @param fd    套接口
+	 * @param func  回调函数. 在io_service线程中调用. 以-EINVAL结束时内核不支持multishot recv,
+	 *              套接口上的数据未被读出, 调用者可改用其它方式接收
+	 * @return
+	 * 接收标识, 用于Cancel()
+	 * @note
+	 * 可在任意线程调用. 接收结束前回调函数及其绑定对象被保留
+	 */
+	uint64_t Receive(int fd, const RecvFunc& func);
+	/*!
+	 * @brief 取消接收
+	 * @param key  接收标识
+	 * @note
+	 * 可在任意线程调用. 回调函数以-ECANCELED结束
+	 */
+	void Cancel(uint64_t key);
+	/*!
+	 * @brief 查看统计: io_uring_enter调用次数、唤醒次数与完成事件数量
+	 */
+	void GetStat(uint64_t& enters, uint64_t& wakeups, uint64_t& cqes);
+
+protected:
+	/*!
+	 * @brief 释放io_uring资源
+	 */
+	virtual void shutdown();
+	/*!
+	 * @brief 创建io_uring, 映射队列, 注册缓冲区环与eventfd
+	 * @return
+	 * 创建结果
+	 */
+	bool setup();
+	/*!
+	 * @brief 关闭io_uring并释放映射
+	 */
+	void release();
+	/*!
+	 * @brief 取一个空闲的提交队列项
+	 * @return
+	 * 提交队列项. 队列已满时先提交
+	 */
+	io_uring_sqe* get_sqe();
+	/*!
+	 * @brief 提交所有未提交的提交队列项
+	 */
+	void submit();
+	/*!
+	 * @brief 归还注册缓冲区
+	 * @param bid  缓冲区编号
+	 */
+	void recycle(unsigned short bid);
+	/*!
+	 * @brief 提交multishot接收
+	 */
+	void arm(uint64_t key, int fd);
+	/*!
+	 * @brief 在io_service线程中提交已登记的接收. 已被取消时直接结束
+	 */
+	void do_arm(uint64_t key);
+	/*!
+	 * @brief 在io_service线程中提交取消
+	 */
+	void do_cancel(uint64_t key);
+	/*!
+	 * @brief 等待eventfd
+	 */
+	void start_wait();
+	/*!
+	 * @brief 处理eventfd可读事件: 处理所有完成事件
+	 */
+	void handle_wait(const boost::system::error_code& ec);
+	/*!
+	 * @brief 处理一个完成事件
+	 */
+	void complete(const io_uring_cqe& cqe);
+};
+
+#endif /* USE_IO_URING */
+
+#endif /* SRC_IOURING_H_ */
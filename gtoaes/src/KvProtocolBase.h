@@ -14,6 +14,7 @@
 #ifndef _KV_PROTOCOL_BASE_H_
 #define _KV_PROTOCOL_BASE_H_
 
+#include <stdint.h>
 #include <string>
 #include <list>
 #include <boost/smart_ptr/shared_ptr.hpp>
@@ -44,8 +45,13 @@ struct kv_proto_base {
 	string gid;		///< 组编号
 	string uid;		///< 单元编号
 	string cid;		///< 相机编号
+	int64_t arrival;	///< 到达时间: UTC, 自1970-01-01起的纳秒数. 0: 未知
 
 public:
+	kv_proto_base() {
+		arrival = 0;
+	}
+
 	kv_proto_base &operator=(const kv_proto_base &other) {
 		if (this != &other) {
 			type = other.type;
@@ -53,6 +59,7 @@ public:
 			gid  = other.gid;
 			uid  = other.uid;
 			cid  = other.cid;
+			arrival = other.arrival;
 		}
 		return *this;
 	}
@@ -0,0 +1,140 @@
+/**
+ * @file MessagePayload.h
+ * @brief 消息携带的数据: 类型擦除、只可移动, 随消息一起入队与出队
+ * @version 0.1
+ * @date 2026-10-17
+ * @note
+ * - 数据存储在对象内部(小对象优化), 构造、移动与取出都不分配内存. 超出存储区的类型在编译时报错
+ * - 只可移动: 同一数据只被一个消息响应函数取出
+ * - 按类型取出. 类型不符时返回空值, 不会与其它消息的数据错配
+ */
+
+#ifndef SRC_MESSAGEPAYLOAD_H_
+#define SRC_MESSAGEPAYLOAD_H_
+
+#include <new>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+
+#define PAYLOAD_STORAGE	(2 * sizeof(void*))	///< 数据最大长度, 量纲: 字节. 可容纳一个shared_ptr
+
+class MessagePayload {
+protected:
+	/*!
+	 * @struct Ops
+	 * @brief 数据的类型相关操作. 每种类型一个实例, 其地址同时作为类型标识
+	 */
+	struct Ops {
+		void (*move)(void*, void*);	//< 移动构造
+		void (*destroy)(void*);		//< 析构
+	};
+	using Storage = typename std::aligned_storage<PAYLOAD_STORAGE, alignof(void*)>::type;
+
+protected:
+	/* 成员变量 */
+	Storage buf_;		//< 数据存储区
+	const Ops* ops_;	//< 数据操作. 为NULL时无数据
+
+public:
+	MessagePayload() : ops_(NULL) {
+	}
+
+	/*!
+	 * @brief 由数据构造, 如shared_ptr
+	 */
+	template <typename T, typename = typename std::enable_if<
+		!std::is_same<typename std::decay<T>::type, MessagePayload>::value>::type>
+	explicit MessagePayload(T&& value) : ops_(NULL) {
+		using Val = typename std::decay<T>::type;
+		static_assert(sizeof(Val) <= PAYLOAD_STORAGE, "payload is too large for MessagePayload");
+		static_assert(alignof(Val) <= alignof(Storage), "payload is over-aligned for MessagePayload");
+
+		new (&buf_) Val(std::forward<T>(value));
+		ops_ = &table<Val>();
+	}
+
+	MessagePayload(MessagePayload&& other) : ops_(NULL) {
+		take_from(other);
+	}
+
+	MessagePayload(const MessagePayload&) = delete;
+	MessagePayload& operator=(const MessagePayload&) = delete;
+
+	~MessagePayload() {
+		Clear();
+	}
+
+	MessagePayload& operator=(MessagePayload&& other) {
+		if (this != &other) {
+			Clear();
+			take_from(other);
+		}
+		return *this;
+	}
+
+	/*!
+	 * @brief 释放数据
+	 */
+	void Clear() {
+		if (ops_) {
+			ops_->destroy(&buf_);
+			ops_ = NULL;
+		}
+	}
+	/*!
+	 * @brief 检查是否携带数据
+	 */
+	bool IsEmpty() const {
+		return ops_ == NULL;
+	}
+	/*!
+	 * @brief 查看指定类型的数据
+	 * @return
+	 * 数据地址. 无数据或类型不符时返回NULL
+	 */
+	template <typename T>
+	T* Get() {
+		return ops_ == &table<T>() ? reinterpret_cast<T*>(&buf_) : NULL;
+	}
+	/*!
+	 * @brief 取出指定类型的数据
+	 * @return
+	 * 数据. 无数据或类型不符时返回T()
+	 */
+	template <typename T>
+	T Take() {
+		T* ptr = Get<T>();
+		if (!ptr) return T();
+		T value(std::move(*ptr));
+		Clear();
+		return value;
+	}
+
+protected:
+	void take_from(MessagePayload& other) {
+		if (other.ops_) {
+			other.ops_->move(&buf_, &other.buf_);
+			ops_ = other.ops_;
+			other.Clear();
+		}
+	}
+
+	template <typename T>
+	static const Ops& table() {
+		static const Ops ops = { &move<T>, &destroy<T> };
+		return ops;
+	}
+
+	template <typename T>
+	static void move(void* dst, void* src) {
+		new (dst) T(std::move(*static_cast<T*>(src)));
+	}
+
+	template <typename T>
+	static void destroy(void* p) {
+		static_cast<T*>(p)->~T();
+	}
+};
+
+#endif /* SRC_MESSAGEPAYLOAD_H_ */
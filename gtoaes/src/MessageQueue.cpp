@@ -1,22 +1,165 @@
 /*!
- * @file MessageQueue.h 声明文件, 基于boost::interprocess::ipc::message_queue封装消息队列
+ * @file MessageQueue.cpp 定义文件, 封装进程内消息队列
  * @version 0.2
  * @date 2017-10-02
  * - 优化消息队列实现方式
  * @date 2020-10-01
  * - 优化
+ * @version 0.3
+ * @date 2026-10-17
+ * - 以进程内有界无锁环形队列与futex替代共享内存消息队列
+ * @version 0.4
+ * @date 2026-10-17
+ * - 消息携带只可移动的数据
+ * - 可合并消息
  */
 
+#include <limits.h>
 #include <boost/bind/bind.hpp>
+#include <boost/chrono/chrono.hpp>
+#include <boost/smart_ptr/make_shared.hpp>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
 #include "MessageQueue.h"
 #include "GLog.h"
 
 using namespace boost::placeholders;
-using namespace boost::interprocess;
 
+#define MQ_DEPTH	1024	///< 每个优先级的队列深度
+
+/*!
+ * @brief 当*addr等于val时等待, 直至被唤醒
+ */
+static void futex_wait(std::atomic<uint32_t>* addr, uint32_t val) {
+#ifdef __linux__
+	syscall(SYS_futex, (uint32_t*) addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+#else
+	// 无futex的系统: 短暂休眠后由调用者重新检查
+	if (addr->load() == val) boost::this_thread::sleep_for(boost::chrono::microseconds(100));
+#endif
+}
+
+/*!
+ * @brief 唤醒在addr上等待的线程
+ * @param n 最多唤醒的线程数量
+ */
+static void futex_wake(std::atomic<uint32_t>* addr, int n) {
+#ifdef __linux__
+	syscall(SYS_futex, (uint32_t*) addr, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+MessageQueue::Ring::Ring(uint32_t depth)
+	: head_(0), tail_(0) {
+	uint32_t n(2), i;
+	while (n < depth) n <<= 1;
+	std::vector<Cell> cells(n);
+	cells_.swap(cells);
+	mask_ = n - 1;
+	for (i = 0; i < n; ++i) cells_[i].seq.store(i, std::memory_order_relaxed);
+}
+
+bool MessageQueue::Ring::Push(Message& msg) {
+	uint32_t pos = head_.load(std::memory_order_relaxed);
+	Cell* cell;
+
+	while (1) {
+		cell = &cells_[pos & mask_];
+		int32_t diff = int32_t(cell->seq.load(std::memory_order_acquire) - pos);
+		if (diff == 0) {// 单元可写: 竞争写入位置
+			if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+		}
+		else if (diff < 0) return false;	// 队列已满
+		else pos = head_.load(std::memory_order_relaxed);	// 其它生产者已占用该单元
+	}
+	cell->msg = std::move(msg);
+	cell->seq.store(pos + 1, std::memory_order_release);
+	return true;
+}
+
+bool MessageQueue::Ring::Pop(Message& msg) {
+	uint32_t pos = tail_.load(std::memory_order_relaxed);
+	Cell* cell = &cells_[pos & mask_];
+	if (cell->seq.load(std::memory_order_acquire) != pos + 1) return false;
+	msg = std::move(cell->msg);
+	cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+	tail_.store(pos + 1, std::memory_order_relaxed);
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+MessageQueue::SlotEntryPtr MessageQueue::MessageSlot::Store(MessagePayload&& payload, long par1, long par2) {
+	lock();
+	if (open_.use_count()) {
+		open_->payload = std::move(payload);
+		unlock();
+		return SlotEntryPtr();
+	}
+	unlock();
+
+	// 在锁外创建消息
+	SlotEntryPtr entry = boost::make_shared<Entry>();
+	entry->slot = shared_from_this();
+	entry->payload = std::move(payload);
+	entry->par1 = par1;
+	entry->par2 = par2;
+	lock();
+	if (open_.use_count()) {// 其它生产者已入队
+		open_->payload = std::move(entry->payload);
+		entry.reset();
+	}
+	else open_ = entry;
+	unlock();
+	return entry;
+}
+
+void MessageQueue::MessageSlot::Seal() {
+	lock();
+	open_.reset();
+	unlock();
+}
+
+void MessageQueue::MessageSlot::Load(const SlotEntryPtr& entry, Message& msg) {
+	Pointer slot = entry->slot.lock();	// 单元已释放时不再有生产者写入
+	if (slot.use_count()) {
+		slot->lock();
+		if (slot->open_ == entry) slot->open_.reset();
+	}
+	msg.payload = std::move(entry->payload);
+	msg.par1 = entry->par1;
+	msg.par2 = entry->par2;
+	if (slot.use_count()) slot->unlock();
+}
+
+void MessageQueue::MessageSlot::lock() {
+	while (lock_.test_and_set(std::memory_order_acquire)) boost::this_thread::yield();
+}
+
+MessageQueue::SlotPtr MessageQueue::SlotGroup::Find(const std::string& key) {
+	SlotPtr& slot = slots_[key];
+	if (!slot.use_count()) slot = MessageSlot::Create();
+	return slot;
+}
+
+void MessageQueue::SlotGroup::Seal() {
+	for (auto it = slots_.begin(); it != slots_.end(); ++it) it->second->Seal();
+}
+
+//////////////////////////////////////////////////////////////////////////////
 MessageQueue::MessageQueue()
-	: szFunc_ (128) {
+	: szFunc_ (128)
+	, posted_(0)
+	, freed_(0)
+	, idle_(0)
+	, blocked_(0)
+	, quit_(false)
+	, coalesced_(0) {
 	funcs_.reset(new CallbackFunc[szFunc_]);
+	funcsPayload_.reset(new PayloadFunc[szFunc_]);
 }
 
 MessageQueue::~MessageQueue() {
@@ -27,13 +170,14 @@ bool MessageQueue::Start(const char *name) {
 
 	try {
 		// 启动消息队列
-		mqptr_.reset(new MQ(open_or_create, name, 1024, sizeof(Message)));
+		for (int i = 0; i < PRIORITY_MAX; ++i) rings_[i].reset(new Ring(MQ_DEPTH));
+		quit_ = false;
 		register_messages();
 		thrd_msg_.reset(new boost::thread(boost::bind(&MessageQueue::thread_message, this)));
 
 		return true;
 	}
-	catch(interprocess_exception &ex) {
+	catch(std::exception &ex) {
 		_gLog.Write(LOG_FAULT, "[%s] %d. %s", __FILE__, __LINE__, ex.what());
 		return false;
 	}
@@ -54,17 +198,92 @@ bool MessageQueue::RegisterMessage(const long id, const CBSlot& slot) {
 	return rslt;
 }
 
+bool MessageQueue::RegisterPayload(const long id, const PayloadSlot& slot) {
+	long pos(id - MSG_USER);
+	bool rslt = pos >= 0 && pos < szFunc_;
+	if (rslt) funcsPayload_[pos].connect(slot);
+	return rslt;
+}
+
 void MessageQueue::PostMessage(const long id, const long par1, const long par2) {
-	if (mqptr_.unique()) {
+	if (thrd_msg_.unique()) {
 		Message msg(id, par1, par2);
-		mqptr_->send(&msg, sizeof(Message), 1);
+		push(msg, PRIORITY_LOW);
+	}
+}
+
+void MessageQueue::PostMessage(const long id, MessagePayload&& payload, const long par1, const long par2) {
+	if (thrd_msg_.unique()) {
+		Message msg(id, std::move(payload), par1, par2);
+		push(msg, PRIORITY_LOW);
 	}
 }
 
 void MessageQueue::SendMessage(const long id, const long par1, const long par2) {
-	if (mqptr_.unique()) {
+	if (thrd_msg_.unique()) {
 		Message msg(id, par1, par2);
-		mqptr_->send(&msg, sizeof(Message), 10);
+		push(msg, PRIORITY_HIGH);
+	}
+}
+
+void MessageQueue::SendMessage(const long id, MessagePayload&& payload, const long par1, const long par2) {
+	if (thrd_msg_.unique()) {
+		Message msg(id, std::move(payload), par1, par2);
+		push(msg, PRIORITY_HIGH);
+	}
+}
+
+void MessageQueue::PostMessage(const long id, const SlotPtr& slot, MessagePayload&& payload,
+		const long par1, const long par2) {
+	if (!thrd_msg_.unique()) return;
+	SlotEntryPtr entry = slot->Store(std::move(payload), par1, par2);
+	if (entry.use_count()) {// 消息携带Entry入队, 处理时取出最新数据
+		Message msg(id, MessagePayload(std::move(entry)));
+		push(msg, PRIORITY_LOW);
+	}
+	else ++coalesced_;
+}
+
+void MessageQueue::PostMessage(const long id, const SlotPtr& slot, const long par1, const long par2) {
+	PostMessage(id, slot, MessagePayload(), par1, par2);
+}
+
+void MessageQueue::push(Message& msg, int prio) {
+	Ring* ring = rings_[prio].get();
+	while (!ring->Push(msg)) {// 队列已满: 等待消息响应线程读出
+		uint32_t freed = freed_.load();
+		if (quit_.load()) return;
+		++blocked_;
+		if (!ring->Push(msg)) futex_wait(&freed_, freed);
+		else {
+			--blocked_;
+			break;
+		}
+		--blocked_;
+	}
+	++posted_;
+	if (idle_.load()) futex_wake(&posted_, 1);
+}
+
+void MessageQueue::pop(Message& msg) {
+	Ring* high = rings_[PRIORITY_HIGH].get();
+	Ring* low  = rings_[PRIORITY_LOW].get();
+
+	while (!(high->Pop(msg) || low->Pop(msg))) {// 队列为空: 等待生产者投递
+		uint32_t posted = posted_.load();
+		idle_ = 1;
+		if (!(high->Pop(msg) || low->Pop(msg))) futex_wait(&posted_, posted);
+		else {
+			idle_ = 0;
+			break;
+		}
+		idle_ = 0;
+	}
+	// 单元释放对等待空间的生产者可见后, 再检查是否有生产者等待
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (blocked_.load() && high->Size() <= MQ_DEPTH / 2 && low->Size() <= MQ_DEPTH / 2) {
+		++freed_;
+		futex_wake(&freed_, INT_MAX);
 	}
 }
 
@@ -78,14 +297,23 @@ void MessageQueue::interrupt_thread(ThreadPtr& thrd) {
 
 void MessageQueue::thread_message() {
 	Message msg;
-	MQ::size_type szrcv;
-	MQ::size_type szmsg = sizeof(Message);
-	uint32_t priority;
 	long pos;
 
 	do {
-		mqptr_->receive(&msg, szmsg, szrcv, priority);
-		if ((pos = msg.id - MSG_USER) >= 0 && pos < szFunc_)
-			(funcs_[pos])(msg.par1, msg.par2);
+		pop(msg);
+		SlotEntryPtr* entry = msg.payload.Get<SlotEntryPtr>();
+		if (entry) {// 可合并消息: 取出最新数据
+			SlotEntryPtr ptr(std::move(*entry));
+			MessageSlot::Load(ptr, msg);
+		}
+		if ((pos = msg.id - MSG_USER) >= 0 && pos < szFunc_) {
+			if (!funcsPayload_[pos].empty()) (funcsPayload_[pos])(msg.par1, msg.par2, msg.payload);
+			else (funcs_[pos])(msg.par1, msg.par2);
+			msg.payload.Clear();	// 未被取出的数据随消息释放
+		}
 	} while(msg.id != MSG_QUIT);
+	// 唤醒等待队列空间的生产者
+	quit_ = true;
+	++freed_;
+	futex_wake(&freed_, INT_MAX);
 }
@@ -1,21 +1,46 @@
 /*!
- * @file MessageQueue.h 声明文件, 基于boost::interprocess::ipc::message_queue封装消息队列
+ * @file MessageQueue.h 声明文件, 封装进程内消息队列
  * @version 0.2
  * @date 2017-10-02
  * - 优化消息队列实现方式
  * @date 2020-10-01
  * - 优化
  * - 面向gtoaes, 将GeneralControl和ObservationSystem的共同特征迁移至此处
+ * @version 0.3
+ * @date 2026-10-17
+ * - 生产者与消费者位于同一进程, 以进程内有界无锁环形队列替代共享内存消息队列
+ * - 多生产者/单消费者: 生产者以CAS竞争写入位置, 消息响应线程独占读出位置
+ * - 高、低优先级消息各使用一个环形队列, 优先读出高优先级消息
+ * - 队列为空时消息响应线程在futex上等待, 队列已满时生产者在futex上等待.
+ *   队列读出过半后才唤醒等待空间的生产者, 避免逐条唤醒
+ * @version 0.4
+ * @date 2026-10-17
+ * - 消息携带只可移动的数据(MessagePayload), 数据与消息在同一次入队/出队中传递,
+ *   不再经由另行加锁的队列按顺序匹配
+ * - 携带数据的消息由RegisterPayload()注册响应函数
+ * - 可合并消息: 经MessageSlot投递. 同一单元已有未处理消息时替换其数据, 不再入队,
+ *   消息响应线程总是处理最新数据. 同一来源的其它消息入队后不再合并, 保持消息顺序
+ * - 高优先级队列作为安全通道: 降水等安全相关消息由SendMessage()投递,
+ *   在当前消息处理完成后立即处理, 不等待已排队的普通消息
+ * - 消息响应线程退出后, 等待队列空间的生产者放弃投递, 避免停止时阻塞
+ * - 可合并消息按键值区分暂存单元(SlotGroup): 一个来源承载多个设备时, 只合并同一设备的消息
  */
 
 #ifndef SRC_MESSAGEQUEUE_H_
 #define SRC_MESSAGEQUEUE_H_
 
-#include <boost/interprocess/ipc/message_queue.hpp>
+#include <atomic>
+#include <vector>
+#include <map>
+#include <string>
+#include <stdint.h>
 #include <boost/thread/thread.hpp>
 #include <boost/smart_ptr/shared_ptr.hpp>
+#include <boost/smart_ptr/weak_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
 #include <boost/smart_ptr/shared_array.hpp>
 #include <boost/signals2/signal.hpp>
+#include "MessagePayload.h"
 
 class MessageQueue {
 protected:
@@ -23,6 +48,7 @@ protected:
 	struct Message {
 		long id;			// 消息编号
 		long par1, par2;	// 参数
+		MessagePayload payload;	// 数据
 
 	public:
 		Message() {
@@ -34,14 +60,161 @@ protected:
 			par1 = _par1;
 			par2 = _par2;
 		}
+
+		Message(long _id, MessagePayload&& _payload, long _par1 = 0, long _par2 = 0)
+			: payload(std::move(_payload)) {
+			id   = _id;
+			par1 = _par1;
+			par2 = _par2;
+		}
+
+		Message(Message&& other) = default;
+		Message& operator=(Message&& other) = default;
+	};
+
+	/*!
+	 * @class Ring
+	 * @brief 有界多生产者/单消费者环形队列
+	 * @note
+	 * 每个单元携带序号: 序号等于写入位置时可写, 等于写入位置+1时可读
+	 */
+	class Ring {
+	protected:
+		struct Cell {
+			std::atomic<uint32_t> seq;	//< 单元序号
+			Message msg;				//< 消息
+		};
+
+	protected:
+		std::vector<Cell> cells_;	//< 存储单元. 数量为2的幂
+		uint32_t mask_;				//< 位置掩码
+		std::atomic<uint32_t> head_;	//< 写入位置, 生产者共享
+		std::atomic<uint32_t> tail_;	//< 读出位置, 仅由消费者修改
+
+	public:
+		/*!
+		 * @param depth 队列深度. 取不小于depth的2的幂
+		 */
+		Ring(uint32_t depth);
+		/*!
+		 * @brief 尝试写入消息
+		 * @param msg 消息. 写入成功时其数据被移入队列
+		 * @return
+		 * 队列已满时返回false
+		 */
+		bool Push(Message& msg);
+		/*!
+		 * @brief 尝试读出消息. 仅由消费者调用
+		 * @return
+		 * 队列为空时返回false
+		 */
+		bool Pop(Message& msg);
+		/*!
+		 * @brief 查看队列中消息数量. 并发写入时为近似值
+		 */
+		uint32_t Size() const {
+			return head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_relaxed);
+		}
+	};
+
+	/*!
+	 * @class MessageSlot
+	 * @brief 可合并消息的暂存单元
+	 * @note
+	 * - 每个合并键值一个实例, 例如一个网络连接的状态信息
+	 * - 经同一单元投递的消息入队时创建Entry. 该消息被处理前再次投递时替换Entry的数据, 参数保留首条消息的值
+	 * - 同一来源的其它消息入队前调用Seal(): 已排队的消息不再接受新数据, 之后的投递重新入队.
+	 *   合并不改变同一来源消息之间的处理顺序
+	 * - 以自旋锁保护, 临界区只移动数据
+	 */
+	class MessageSlot : public boost::enable_shared_from_this<MessageSlot> {
+	public:
+		using Pointer = boost::shared_ptr<MessageSlot>;
+		/*!
+		 * @struct Entry
+		 * @brief 一条已入队的可合并消息. 由消息携带
+		 */
+		struct Entry {
+			boost::weak_ptr<MessageSlot> slot;	//< 所属暂存单元
+			MessagePayload payload;		//< 最新数据
+			long par1, par2;			//< 首条消息的参数
+		};
+		using EntryPtr = boost::shared_ptr<Entry>;
+
+	protected:
+		std::atomic_flag lock_;		//< 自旋锁
+		EntryPtr open_;				//< 已入队且可接受新数据的消息. 为空时下一次投递重新入队
+
+	public:
+		MessageSlot() {
+			lock_.clear();
+		}
+		static Pointer Create() {
+			return Pointer(new MessageSlot);
+		}
+		/*!
+		 * @brief 存储消息数据
+		 * @return
+		 * 需要入队的消息. 已有可接受新数据的消息时替换其数据并返回空指针
+		 */
+		EntryPtr Store(MessagePayload&& payload, long par1, long par2);
+		/*!
+		 * @brief 封闭已入队的消息. 之后的投递重新入队
+		 */
+		void Seal();
+		/*!
+		 * @brief 由消息响应线程取出最新数据. 之后的投递重新入队
+		 */
+		static void Load(const EntryPtr& entry, Message& msg);
+
+	protected:
+		void lock();
+		void unlock() {
+			lock_.clear(std::memory_order_release);
+		}
+	};
+
+	/*!
+	 * @class SlotGroup
+	 * @brief 一个来源的暂存单元集合, 按合并键值区分
+	 * @note
+	 * - 一个网络连接可能承载多个设备的状态(P2H模式的gid:uid, 或相机cid).
+	 *   每个设备使用独立的暂存单元, 只由同一设备的新状态替换旧状态
+	 * - Seal()封闭所有单元, 保持与同一来源其它消息的顺序
+	 * - 仅由来源所在的I/O线程访问, 不加锁
+	 */
+	class SlotGroup {
+	public:
+		using Pointer = boost::shared_ptr<SlotGroup>;
+
+	protected:
+		std::map<std::string, MessageSlot::Pointer> slots_;	//< 暂存单元. 关键字: 合并键值
+
+	public:
+		static Pointer Create() {
+			return Pointer(new SlotGroup);
+		}
+		/*!
+		 * @brief 查找合并键值对应的暂存单元. 不存在时创建
+		 */
+		MessageSlot::Pointer Find(const std::string& key);
+		/*!
+		 * @brief 封闭所有单元已入队的消息
+		 */
+		void Seal();
 	};
 
 	//////////////////////////////////////////////////////////////////////////////
 	using CallbackFunc = boost::signals2::signal<void (const long, const long)>;	///< 消息回调函数
 	using CBSlot = CallbackFunc::slot_type;	///< 回调函数插槽
 	using CBArray = boost::shared_array<CallbackFunc>;	///< 回调函数数组
-	using MQ = boost::interprocess::message_queue;	///< boost消息队列
-	using MQPtr = boost::shared_ptr<MQ>;	///< boost消息队列指针
+	using PayloadFunc = boost::signals2::signal<void (const long, const long, MessagePayload&)>;	///< 携带数据的消息回调函数
+	using PayloadSlot = PayloadFunc::slot_type;	///< 携带数据的消息回调函数插槽
+	using PayloadArray = boost::shared_array<PayloadFunc>;	///< 携带数据的消息回调函数数组
+	using RingPtr = boost::shared_ptr<Ring>;	///< 环形队列指针
+	using SlotPtr = MessageSlot::Pointer;	///< 可合并消息暂存单元指针
+	using SlotEntryPtr = MessageSlot::EntryPtr;	///< 已入队的可合并消息
+	using SlotGroupPtr = SlotGroup::Pointer;	///< 暂存单元集合指针
 	using MtxLck = boost::unique_lock<boost::mutex>;	///< 信号灯互斥锁
 	using ThreadPtr = boost::shared_ptr<boost::thread>;	///< boost线程指针
 
@@ -53,11 +226,24 @@ protected:
 		MSG_USER		///< 用户自定义消息起始编号
 	};
 
+	enum {
+		PRIORITY_HIGH,	///< 高优先级队列: 安全通道
+		PRIORITY_LOW,	///< 低优先级队列
+		PRIORITY_MAX
+	};
+
 	//////////////////////////////////////////////////////////////////////////////
 	/* 消息队列 */
 	const long szFunc_;	///< 自定义回调函数数组长度
-	MQPtr mqptr_;		///< 消息队列
+	RingPtr rings_[PRIORITY_MAX];	///< 按优先级划分的消息队列
 	CBArray funcs_;		///< 回调函数数组
+	PayloadArray funcsPayload_;	///< 携带数据的消息回调函数数组
+	std::atomic<uint32_t> posted_;	///< futex: 投递计数. 消息响应线程等待其变化
+	std::atomic<uint32_t> freed_;	///< futex: 读出计数. 队列已满时生产者等待其变化
+	std::atomic<int> idle_;			///< 消息响应线程正在等待
+	std::atomic<int> blocked_;		///< 等待队列空间的生产者数量
+	std::atomic<bool> quit_;		///< 消息响应线程已退出. 等待队列空间的生产者放弃投递
+	std::atomic<uint64_t> coalesced_;	///< 被合并的消息数量
 
 	/* 多线程 */
 	ThreadPtr thrd_msg_;		///< 消息响应线程
@@ -67,7 +253,7 @@ public:
 	virtual ~MessageQueue();
 	/*!
 	 * @brief 创建消息队列并启动监测/响应服务
-	 * @param name 消息队列名称
+	 * @param name 消息队列名称. 进程内队列不使用名称, 保留以兼容调用者
 	 * @return
 	 * 操作结果. false代表失败
 	 */
@@ -84,6 +270,16 @@ public:
 	 * 消息注册结果. 若失败返回false
 	 */
 	bool RegisterMessage(const long id, const CBSlot& slot);
+	/*!
+	 * @brief 注册携带数据的消息及其响应函数
+	 * @param id   消息代码
+	 * @param slot 回调函数插槽. 由第三个参数取出数据
+	 * @return
+	 * 消息注册结果. 若失败返回false
+	 * @note
+	 * 同一消息同时注册两类响应函数时, 只调用携带数据的响应函数
+	 */
+	bool RegisterPayload(const long id, const PayloadSlot& slot);
 	/*!
 	 * @brief 投递低优先级消息
 	 * @param id   消息代码
@@ -91,13 +287,55 @@ public:
 	 * @param par2 参数2
 	 */
 	void PostMessage(const long id, const long par1 = 0, const long par2 = 0);
+	/*!
+	 * @brief 投递携带数据的低优先级消息
+	 * @param id      消息代码
+	 * @param payload 数据, 被移入消息
+	 * @param par1    参数1
+	 * @param par2    参数2
+	 */
+	void PostMessage(const long id, MessagePayload&& payload, const long par1 = 0, const long par2 = 0);
 	/*!
 	 * @brief 投递高优先级消息
 	 * @param id   消息代码
+	 * @note
+	 * 仅用于安全相关消息. 同一通道内保持投递顺序, 但先于已排队的低优先级消息处理
 	 * @param par1 参数1
 	 * @param par2 参数2
 	 */
 	void SendMessage(const long id, const long par1 = 0, const long par2 = 0);
+	/*!
+	 * @brief 投递携带数据的高优先级消息
+	 * @param id      消息代码
+	 * @param payload 数据, 被移入消息
+	 * @param par1    参数1
+	 * @param par2    参数2
+	 */
+	void SendMessage(const long id, MessagePayload&& payload, const long par1 = 0, const long par2 = 0);
+	/*!
+	 * @brief 投递可合并的低优先级消息
+	 * @param id      消息代码
+	 * @param slot    暂存单元. 单元已有未处理且未封闭(MessageSlot::Seal())的消息时只替换其数据
+	 * @param payload 数据, 被移入暂存单元
+	 * @param par1    参数1
+	 * @param par2    参数2
+	 */
+	void PostMessage(const long id, const SlotPtr& slot, MessagePayload&& payload,
+			const long par1 = 0, const long par2 = 0);
+	/*!
+	 * @brief 投递可合并的不携带数据的低优先级消息
+	 * @param id      消息代码
+	 * @param slot    暂存单元. 单元已有未处理且未封闭的消息时不再入队
+	 * @param par1    参数1
+	 * @param par2    参数2
+	 */
+	void PostMessage(const long id, const SlotPtr& slot, const long par1 = 0, const long par2 = 0);
+	/*!
+	 * @brief 查看被合并的消息数量
+	 */
+	uint64_t CoalescedCount() const {
+		return coalesced_.load();
+	}
 
 protected:
 	/* 消息响应函数 */
@@ -112,6 +350,17 @@ protected:
 	 * @param thrd 线程指针
 	 */
 	void interrupt_thread(ThreadPtr& thrd);
+	/*!
+	 * @brief 写入消息. 队列已满时等待消息响应线程读出
+	 * @param msg  消息
+	 * @param prio 优先级
+	 */
+	void push(Message& msg, int prio);
+	/*!
+	 * @brief 读出消息. 队列为空时等待
+	 * @param msg 消息
+	 */
+	void pop(Message& msg);
 	/*!
 	 * @brief 线程, 监测/响应消息
 	 */
@@ -0,0 +1,251 @@
+/**
+ * @file NetBuffer.cpp
+ * @brief 连续存储的网络接收缓冲区
+ * @version 0.4
+ * @date 2026-10-16
+ */
+
+#include <string.h>
+#include "NetBuffer.h"
+
+NetBuffer::NetBuffer(int capacity, int initial, const char term) {
+	capacity_ = capacity;
+	init_ = initial > 0 && initial < capacity ? initial : capacity;
+	size_ = hold_size_ = 0;
+	active_ = false;
+	rd_ = wr_ = 0;
+	term_ = term;
+	scan_ = 0;
+	maxline_ = 0;
+	discard_ = false;
+	overflow_ = false;
+}
+
+NetBuffer::~NetBuffer() {
+}
+
+char* NetBuffer::Prepare(int n) {
+	bool lent = slab_.get() && hold_.get() == slab_.get();	// 当前存储区中有已交出信息
+	if (rd_ == wr_ && !lent) rd_ = wr_ = scan_ = 0;
+	if (n > capacity_) n = capacity_;
+	if (wr_ + n > size_) {// 尾部空间不足
+		int size = Size();
+		int to_size(size_);
+		if (size + n > capacity_) {// 存储区已满: 按完整信息丢弃最早接收的数据
+			int need = size + n - capacity_;
+			int to = wr_;
+			for (EolQue::iterator it = eol_.begin(); it != eol_.end(); ++it) {
+				if (*it + 1 - rd_ >= need) {
+					to = *it + 1;
+					break;
+				}
+			}
+			// 未完成信息被丢弃时, 在下一个结束符处恢复同步
+			if (to == wr_ && (eol_.empty() || eol_.back() + 1 != wr_)) discard_ = true;
+			stat_.bytesOverrun += to - rd_;
+			overflow_ = true;
+			rd_ = to;
+			size = wr_ - rd_;
+			drop_lines();
+		}
+		if (size + n > size_ * 3 / 4) {// 倍增存储区
+			to_size = size_ * 2;
+			if (to_size < size + n) to_size = size + n;
+			if (to_size < init_) to_size = init_;
+			if (to_size > capacity_) to_size = capacity_;
+		}
+		// 已交出信息未释放时迁移至新的存储区, 旧存储区保留至信息被释放
+		relocate(to_size, lent || to_size != size_);
+	}
+	return slab_.get() + wr_;
+}
+
+bool NetBuffer::Trim() {
+	bool active(active_);
+	active_ = false;
+	if (active || !slab_.get() || hold_.get() == slab_.get()) return false;
+
+	int size = Size();
+	if (!size) {// 释放存储区
+		slab_.reset();
+		size_ = 0;
+		rd_ = wr_ = scan_ = 0;
+		return true;
+	}
+	if (size_ > init_ && size * 4 < size_) {// 收缩存储区
+		int to_size = size * 2;
+		relocate(to_size < init_ ? init_ : to_size, true);
+		return true;
+	}
+	return false;
+}
+
+void NetBuffer::Reset() {
+	slab_.reset();
+	hold_.reset();
+	size_ = hold_size_ = 0;
+	active_ = false;
+	rd_ = wr_ = scan_ = 0;
+	eol_.clear();
+	maxline_ = 0;
+	discard_ = false;
+	stat_ = NetReadStat();
+	overflow_ = false;
+}
+
+int NetBuffer::Memory() const {
+	int n = slab_.get() ? size_ : 0;
+	if (hold_.get() && hold_.get() != slab_.get()) n += hold_size_;
+	return n;
+}
+
+void NetBuffer::relocate(int to_size, bool realloc) {
+	int size = Size();
+	if (realloc) {
+		CBuff slab(new char[to_size]);
+		if (size) memcpy(slab.get(), slab_.get() + rd_, size);
+		slab_ = slab;
+		size_ = to_size;
+	}
+	else if (size && rd_) memmove(slab_.get(), slab_.get() + rd_, size);
+	// 信息边界随数据迁移
+	for (EolQue::iterator it = eol_.begin(); it != eol_.end(); ++it)
+		*it -= rd_;
+	scan_ -= rd_;
+	rd_ = 0;
+	wr_ = size;
+}
+
+void NetBuffer::Commit(int n) {
+	if (n > 0) {
+		active_ = true;
+		wr_ += n;
+		scan_lines();
+	}
+}
+
+void NetBuffer::SetMaxLine(int n) {
+	maxline_ = n;
+}
+
+bool NetBuffer::CheckOverflow(NetReadStat& stat) {
+	bool overflow(overflow_);
+	stat = stat_;
+	overflow_ = false;
+	return overflow;
+}
+
+void NetBuffer::Consume(int n) {
+	if (n > Size()) n = Size();
+	if (n > 0) {
+		rd_ += n;
+		drop_lines();
+	}
+}
+
+int NetBuffer::Find(const char* flag, const int n, const int from) {
+	if (!flag || n <= 0 || from < 0 || from + n > Size()) return -1;
+
+	if (n == 1 && flag[0] == term_) {// 查找信息结束符
+		for (EolQue::iterator it = eol_.begin(); it != eol_.end(); ++it) {
+			if (*it - rd_ >= from) return *it - rd_;
+		}
+		return -1;
+	}
+
+	const char* data = Data();
+	const char* end  = data + Size() - n;	// 可能匹配的最后位置
+	const char* ptr;
+	for (ptr = data + from; ptr <= end; ++ptr) {
+		if (!(ptr = (const char*) memchr(ptr, flag[0], end - ptr + 1))) break;
+		if (n == 1 || !memcmp(ptr + 1, flag + 1, n - 1)) return ptr - data;
+	}
+	return -1;
+}
+
+int NetBuffer::Read(char* data, const int n, const int from) {
+	if (!data || n <= 0 || from < 0 || from >= Size()) return 0;
+
+	int end(from + n), to_read;
+	to_read = Size() > end ? n : Size() - from;
+	memcpy(data, Data() + from, to_read);
+	Consume(from + to_read);
+	return to_read;
+}
+
+char* NetBuffer::ReadLine(int& n) {
+	lend(!eol_.empty());
+	if (eol_.empty()) {
+		n = 0;
+		return NULL;
+	}
+
+	char* data = slab_.get() + rd_;
+	int pos = eol_.front();
+	eol_.pop_front();
+	n = pos - rd_;
+	data[n] = 0;
+	rd_ = pos + 1;
+	return data;
+}
+
+int NetBuffer::ExtractLines(LineVec& lines) {
+	lines.clear();
+	lend(!eol_.empty());
+
+	char* slab = slab_.get();
+	for (EolQue::iterator it = eol_.begin(); it != eol_.end(); ++it) {
+		slab[*it] = 0;
+		lines.push_back(Line(slab + rd_, *it - rd_));
+		rd_ = *it + 1;
+	}
+	eol_.clear();
+	return lines.size();
+}
+
+void NetBuffer::Release() {
+	hold_.reset();
+}
+
+void NetBuffer::scan_lines() {
+	char* slab = slab_.get();
+	char* ptr;
+	int begin = eol_.empty() ? rd_ : eol_.back() + 1;	// 未完成信息的起始位置
+	int pos, len;
+
+	if (scan_ < begin) scan_ = begin;
+	while (scan_ < wr_) {
+		ptr = (char*) memchr(slab + scan_, term_, wr_ - scan_);
+		pos = ptr ? ptr - slab : wr_;
+		if (discard_ || (maxline_ > 0 && pos - begin > maxline_)) {// 超长信息: 丢弃至结束符
+			len = ptr ? pos + 1 - begin : wr_ - begin;
+			if (!discard_) ++stat_.linesDiscarded;
+			stat_.bytesDiscarded += len;
+			overflow_ = true;
+			discard_ = !ptr;
+			if (ptr && wr_ > pos + 1) memmove(slab + begin, slab + pos + 1, wr_ - pos - 1);
+			wr_ -= len;
+			scan_ = begin;
+		}
+		else if (ptr) {
+			eol_.push_back(pos);
+			begin = scan_ = pos + 1;
+		}
+		else scan_ = wr_;
+	}
+}
+
+void NetBuffer::drop_lines() {
+	while (!eol_.empty() && eol_.front() < rd_) eol_.pop_front();
+	if (scan_ < rd_) scan_ = rd_;
+}
+
+void NetBuffer::lend(bool lent) {
+	if (lent) {
+		if (hold_.get() != slab_.get()) {
+			hold_ = slab_;
+			hold_size_ = size_;
+		}
+	}
+	else hold_.reset();
+}
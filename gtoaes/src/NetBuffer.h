@@ -0,0 +1,232 @@
+/**
+ * @file NetBuffer.h
+ * @brief 连续存储的网络接收缓冲区
+ * @version 0.1
+ * @date 2026-10-16
+ * @note
+ * - 数据在单块连续内存中存储, 套接口直接写入缓冲区尾部, 无需逐字节拷贝
+ * - 使用memchr查找结束符. glibc的memchr使用SSE2/AVX2实现
+ * - ReadLine()返回缓冲区内的信息首地址, 不拷贝数据
+ * - 缓冲区本身不加锁, 由调用者保证互斥
+ * @version 0.2
+ * @date 2026-10-16
+ * @note
+ * - 记录结束符扫描位置与已发现的信息边界. 重复查找只扫描新到达数据
+ * - 新增ExtractLines(), 一次取出所有完整信息
+ * @version 0.3
+ * @date 2026-10-16
+ * @note
+ * - 写入数据后立即扫描结束符. 超过最大长度的信息被丢弃, 并在下一个结束符处恢复同步
+ * - 存储区已满时按完整信息丢弃最早接收的数据
+ * - 统计被丢弃的信息与数据
+ * @version 0.4
+ * @date 2026-10-16
+ * @note
+ * - 存储区按需分配: 初始容量较小, 持续接收时倍增至最大容量
+ * - 新增Trim(): 空闲时收缩或释放存储区
+ * - 新增Memory(): 查看占用内存
+ * - 新增Release(): 处理完信息后释放, 使存储区可以被收缩
+ * - 新增Reset(): 清除所有数据与统计, 释放存储区. 用于复用缓冲区
+ */
+
+#ifndef SRC_NETBUFFER_H_
+#define SRC_NETBUFFER_H_
+
+#include <deque>
+#include <vector>
+#include <utility>
+#include <stdint.h>
+#include <boost/smart_ptr/shared_array.hpp>
+
+/*!
+ * @struct NetReadStat
+ * @brief 接收缓冲区溢出统计
+ */
+struct NetReadStat {
+	uint64_t linesDiscarded;	///< 超长而被丢弃的信息数量
+	uint64_t bytesDiscarded;	///< 超长而被丢弃的数据长度
+	uint64_t bytesOverrun;		///< 存储区已满而被丢弃的数据长度
+
+public:
+	NetReadStat() {
+		linesDiscarded = bytesDiscarded = bytesOverrun = 0;
+	}
+};
+
+class NetBuffer {
+public:
+	using CBuff = boost::shared_array<char>;	//< char型数组
+	using Line = std::pair<char*, int>;		//< 信息: 首地址与长度
+	using LineVec = std::vector<Line>;		//< 信息集合
+
+protected:
+	using EolQue = std::deque<int>;			//< 结束符位置队列
+
+protected:
+	/* 成员变量 */
+	CBuff slab_;	//< 存储区
+	CBuff hold_;	//< 已交出信息所在的存储区. 存储区迁移后保留至信息被释放
+	int capacity_;	//< 存储区最大容量
+	int init_;		//< 存储区初始容量
+	int size_;		//< 存储区当前容量
+	int hold_size_;	//< hold_容量
+	bool active_;	//< 上次调用Trim()后写入过数据
+	int rd_;		//< 读出位置
+	int wr_;		//< 写入位置
+	/* 信息边界 */
+	char term_;		//< 信息结束符
+	int scan_;		//< 已扫描结束符的位置
+	EolQue eol_;	//< 已发现但尚未取出的结束符位置
+	int maxline_;	//< 信息最大长度, 不含结束符. <= 0时不限制
+	bool discard_;	//< 正在丢弃超长信息, 直至下一个结束符
+	/* 溢出统计 */
+	NetReadStat stat_;	//< 累计统计
+	bool overflow_;		//< 上次查询后发生溢出
+
+public:
+	/*!
+	 * @param capacity  存储区最大容量
+	 * @param initial   存储区初始容量. <= 0时等于最大容量
+	 * @param term      信息结束符
+	 * @note
+	 * 存储区在首次调用Prepare()时分配
+	 */
+	NetBuffer(int capacity, int initial = 0, const char term = '\n');
+	virtual ~NetBuffer();
+	/*!
+	 * @brief 查看已存储数据长度
+	 */
+	int Size() const {
+		return wr_ - rd_;
+	}
+	/*!
+	 * @brief 查看已存储数据首地址
+	 */
+	const char* Data() const {
+		return slab_.get() + rd_;
+	}
+	/*!
+	 * @brief 准备写入空间
+	 * @param n  待写入数据最大长度
+	 * @return
+	 * 写入地址. 地址后至少有n字节可用空间
+	 * @note
+	 * - 空间不足时迁移数据; 已交出信息未释放时迁移至新的存储区
+	 * - 数据超过当前容量3/4时倍增存储区, 直至最大容量
+	 * - 存储区已满时按完整信息丢弃最早接收的数据
+	 */
+	char* Prepare(int n);
+	/*!
+	 * @brief 收缩存储区
+	 * @return
+	 * 是否收缩或释放了存储区
+	 * @note
+	 * - 上次调用Trim()后写入过数据, 或存在已交出信息时不收缩
+	 * - 无数据时释放存储区, 否则收缩至数据长度的2倍
+	 * - 调用者需保证此时没有未完成的写入
+	 */
+	bool Trim();
+	/*!
+	 * @brief 查看占用内存
+	 * @return
+	 * 存储区容量, 量纲: 字节
+	 */
+	int Memory() const;
+	/*!
+	 * @brief 清除所有数据、信息边界与溢出统计, 并释放存储区
+	 * @note
+	 * 调用者需保证此时没有未完成的写入, 且已交出信息不再被使用
+	 */
+	void Reset();
+	/*!
+	 * @brief 确认写入数据, 并扫描新数据中的结束符
+	 * @param n  实际写入数据长度
+	 * @note
+	 * 超过最大长度的信息在此丢弃. 调用者需保证此时没有未完成的写入
+	 */
+	void Commit(int n);
+	/*!
+	 * @brief 设置信息最大长度
+	 * @param n  信息最大长度, 不含结束符. <= 0时不限制
+	 */
+	void SetMaxLine(int n);
+	/*!
+	 * @brief 检查上次查询后是否发生溢出
+	 * @param stat  累计溢出统计
+	 * @return
+	 * 上次查询后是否丢弃过数据
+	 */
+	bool CheckOverflow(NetReadStat& stat);
+	/*!
+	 * @brief 从缓冲区头部移除数据
+	 * @param n  数据长度
+	 */
+	void Consume(int n);
+	/*!
+	 * @brief 查找标识字符串第一次出现的位置
+	 * @param flag  标识字符串
+	 * @param n     标识字符串长度
+	 * @param from  从from开始查找
+	 * @return
+	 * 标识串相对数据首地址的位置. 若flag不存在则返回-1
+	 * @note
+	 * 查找信息结束符时使用已记录的信息边界
+	 */
+	int Find(const char* flag, const int n, const int from = 0);
+	/*!
+	 * @brief 从已存储数据中拷贝指定长度, 并从缓冲区中清除被读出数据
+	 * @param data 输出存储区
+	 * @param n    待读取数据长度
+	 * @param from 从from开始读取
+	 * @return
+	 * 实际读取数据长度
+	 */
+	int Read(char* data, const int n, const int from = 0);
+	/*!
+	 * @brief 取出第一条完整信息
+	 * @param n  信息长度, 不含结束符
+	 * @return
+	 * 信息首地址. 结束符被替换为'\0'. 若无完整信息则返回NULL
+	 * @note
+	 * 返回地址在下一次调用ReadLine()、ExtractLines()或Release()之前有效
+	 */
+	char* ReadLine(int& n);
+	/*!
+	 * @brief 取出所有完整信息
+	 * @param lines  信息集合. 结束符被替换为'\0'
+	 * @return
+	 * 信息数量
+	 * @note
+	 * 信息地址在下一次调用ReadLine()、ExtractLines()或Release()之前有效
+	 */
+	int ExtractLines(LineVec& lines);
+	/*!
+	 * @brief 释放已交出的信息
+	 * @note
+	 * 调用后此前交出的信息地址失效
+	 */
+	void Release();
+
+protected:
+	/*!
+	 * @brief 将数据迁移至存储区头部
+	 * @param to_size  存储区容量
+	 * @param realloc  是否分配新的存储区
+	 */
+	void relocate(int to_size, bool realloc);
+	/*!
+	 * @brief 扫描新到达数据, 记录结束符位置, 丢弃超长信息
+	 */
+	void scan_lines();
+	/*!
+	 * @brief 读出位置前移后, 移除失效的结束符位置
+	 */
+	void drop_lines();
+	/*!
+	 * @brief 释放已交出的信息, 并在有新信息交出时保留当前存储区
+	 * @param lent  是否交出新的信息
+	 */
+	void lend(bool lent);
+};
+
+#endif /* SRC_NETBUFFER_H_ */
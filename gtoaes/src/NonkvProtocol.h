@@ -12,6 +12,7 @@
 #include <boost/thread/mutex.hpp>
 #include <boost/smart_ptr/shared_ptr.hpp>
 #include <boost/smart_ptr/shared_array.hpp>
+#include <stdint.h>
 #include <string>
 
 using std::string;
@@ -41,14 +42,20 @@ struct nonkv_proto_base {
 	string gid;		///< 组编号
 	string uid;		///< 单元编号
 	string cid;		///< 相机编号
+	int64_t arrival;	///< 到达时间: UTC, 自1970-01-01起的纳秒数. 0: 未知
 
 public:
+	nonkv_proto_base() {
+		arrival = 0;
+	}
+
 	nonkv_proto_base &operator=(const nonkv_proto_base &other) {
 		if (this != &other) {
 			type = other.type;
 			gid  = other.gid;
 			uid  = other.uid;
 			cid  = other.cid;
+			arrival = other.arrival;
 		}
 		return *this;
 	}
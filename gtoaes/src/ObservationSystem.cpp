@@ -45,7 +45,6 @@ bool ObservationSystem::Start() {
 		return false;
 	}
 	// 网络通信
-	bufTcp_.reset(new char[TCP_PACK_SIZE]);
 	kvProto_    = KvProtocol::Create();
 	nonkvProto_ = NonkvProtocol::Create();
 	// 观测计划
@@ -81,6 +80,10 @@ void ObservationSystem::SetDBPtr(DBCurlPtr ptr) {
 	dbPtr_ = ptr;
 }
 
+void ObservationSystem::SetMulticast(McastPtr ptr) {
+	mcast_ = ptr;
+}
+
 void ObservationSystem::RegisterAcquirePlan(const AcqPlanCBSlot& slot) {
 	if (!acqPlan_.empty()) acqPlan_.disconnect_all_slots();
 	acqPlan_.connect(slot);
@@ -151,7 +154,10 @@ int ObservationSystem::CoupleMount(const TcpCPtr client, kvbase base) {
 
 		if (!param_->p2hMount) {// P2P模式, 由OBSS接管网络信息接收/解析
 			const TcpClient::CBSlot& slot = boost::bind(&ObservationSystem::receive_from_peer, this, _1, _2, PEER_MOUNT);
+			const TcpClient::LineFunc& slotLine = boost::bind(&ObservationSystem::parse_from_peer, this, _1, _2, _3, PEER_MOUNT,
+					SlotGroup::Create());
 			client->RegisterRead(slot);
+			client->RegisterLine(slotLine);
 		}
 		PostMessage(MSG_MOUNT_LINKED, 1);
 	}
@@ -186,7 +192,9 @@ int ObservationSystem::CoupleMount(const TcpCPtr client, nonkvbase base) {
 		MtxLck lck(mtx_ats_);
 		// 补充地平坐标
 		nonkvmount proto = from_nonkvbase<nonkv_proto_mount>(base);
-		ptime now = microsec_clock::universal_time();
+		ptime now = proto->arrival	// 坐标的采样时间
+				? ptime(gregorian::date(1970, 1, 1), microseconds(proto->arrival / 1000))
+				: microsec_clock::universal_time();
 		int old_state(net_mount_.state);
 		double azi, alt;
 
@@ -210,7 +218,10 @@ int ObservationSystem::CoupleCamera(const TcpCPtr client, kvbase base) {
 
 		if (!param_->p2hCamera) {
 			const TcpClient::CBSlot& slot = boost::bind(&ObservationSystem::receive_from_peer, this, _1, _2, PEER_CAMERA);
+			const TcpClient::LineFunc& slotLine = boost::bind(&ObservationSystem::parse_from_peer, this, _1, _2, _3, PEER_CAMERA,
+					SlotGroup::Create());
 			client->RegisterRead(slot);
+			client->RegisterLine(slotLine);
 		}
 		PostMessage(MSG_CAMERA_LINKED, 1);
 		if (dbPtr_.use_count()) {//...通知数据库
@@ -259,8 +270,8 @@ void ObservationSystem::DecoupleCamera(const TcpCPtr client) {
 	NetCamVec::iterator it, itend = net_camera_.end();
 	for (it = net_camera_.begin(); it != itend && client != (**it)(); ++it);
 	if (it != itend) {
-		_gLog.Write("Camera[%s:%s:%s] is off-line", gid_.c_str(), uid_.c_str(),
-				(*it)->cid.c_str());
+		_gLog.Write("Camera[%s:%s:%s] is off-line. max queueing delay of status: %.3f ms", gid_.c_str(), uid_.c_str(),
+				(*it)->cid.c_str(), (*it)->queueMaxUs * 1E-3);
 		net_camera_.erase(it);
 		--usable_camera_;
 		PostMessage(MSG_CAMERA_LINKED, 0);
@@ -280,9 +291,7 @@ void ObservationSystem::DecoupleCameraAnnex(const TcpCPtr client) {
 }
 
 void ObservationSystem::NotifyKVClient(kvbase base) {
-	MtxLck lck(mtx_queKv_);
-	queKv_.push_back(base);
-	PostMessage(MSG_RECEIVE_KV);
+	PostMessage(MSG_RECEIVE_KV, MessagePayload(base));
 }
 
 void ObservationSystem::NotifyPlan(ObsPlanItemPtr plan) {
@@ -298,6 +307,7 @@ void ObservationSystem::NotifyPlan(ObsPlanItemPtr plan) {
 	else {// 立即执行计划
 		plan->state = StateObservationPlan::OBSPLAN_RUNNING;
 		plan_now_ = plan;
+		publish_obss();
 		process_plan();
 	}
 }
@@ -323,8 +333,8 @@ void ObservationSystem::NotifySlitState(int state) {
 //////////////////////////////////////////////////////////////////////////////
 /*----------------- 消息响应 -----------------*/
 void ObservationSystem::register_messages() {
-	const CBSlot& slot1 = boost::bind(&ObservationSystem::on_tcp_receive,     this, _1, _2);
-	const CBSlot& slot2 = boost::bind(&ObservationSystem::on_receive_kv,      this, _1, _2);
+	const PayloadSlot& slot1 = boost::bind(&ObservationSystem::on_tcp_receive, this, _1, _2, _3);
+	const PayloadSlot& slot2 = boost::bind(&ObservationSystem::on_receive_kv,  this, _1, _2, _3);
 	const CBSlot& slot3 = boost::bind(&ObservationSystem::on_receive_nonkv,   this, _1, _2);
 	const CBSlot& slot4 = boost::bind(&ObservationSystem::on_mount_linked,    this, _1, _2);
 	const CBSlot& slot5 = boost::bind(&ObservationSystem::on_mount_changed,   this, _1, _2);
@@ -332,8 +342,8 @@ void ObservationSystem::register_messages() {
 	const CBSlot& slot7 = boost::bind(&ObservationSystem::on_camera_changed,  this, _1, _2);
 	const CBSlot& slot8 = boost::bind(&ObservationSystem::on_switch_obsflow,  this, _1, _2);
 
-	RegisterMessage(MSG_TCP_RECEIVE,     slot1);
-	RegisterMessage(MSG_RECEIVE_KV,      slot2);
+	RegisterPayload(MSG_TCP_RECEIVE,     slot1);
+	RegisterPayload(MSG_RECEIVE_KV,      slot2);
 	RegisterMessage(MSG_RECEIVE_NONKV,   slot3);
 	RegisterMessage(MSG_MOUNT_LINKED,    slot4);
 	RegisterMessage(MSG_MOUNT_CHANGED,   slot5);
@@ -342,28 +352,23 @@ void ObservationSystem::register_messages() {
 	RegisterMessage(MSG_SWITCH_OBSFLOW,  slot8);
 }
 
-void ObservationSystem::on_tcp_receive(const long par1, const long par2) {
-	TcpRcvPtr rcvd;
-	{// 取队首
-		MtxLck lck(mtx_tcpRcv_);
-		rcvd = que_tcpRcv_.front();
-		que_tcpRcv_.pop_front();
-	}
+void ObservationSystem::on_tcp_receive(const long par1, const long par2, MessagePayload& payload) {
+	TcpRcvPtr rcvd = payload.Take<TcpRcvPtr>();
+	if (!rcvd.use_count()) return;
 
 	TcpCPtr client = rcvd->client;
+	kvbase base = rcvd->kv;
 	int peer = rcvd->peer;
-	if (rcvd->hadRcvd) {
-		const char term[] = "\n";	// 信息结束符: 换行
-		int lenTerm = strlen(term);	// 结束符长度
-		int pos;
-		while (client->IsOpen() && (pos = client->Lookup(term, lenTerm)) >= 0) {
-			client->Read(bufTcp_.get(), pos + lenTerm);
-			bufTcp_[pos] = 0;
-			if      (peer == PEER_MOUNT)        resolve_kv_mount       (client);
-			else if (peer == PEER_CAMERA)       resolve_kv_camera      (client);
-			else if (peer == PEER_MOUNT_ANNEX)  resolve_kv_mount_annex (client);
-			else if (peer == PEER_CAMERA_ANNEX) resolve_kv_camera_annex(client);
+	if (rcvd->hadRcvd) {// 已在I/O线程中解析. 连接已被关闭时丢弃其后的信息
+		if (!client->IsOpen()) return;
+		if (!base.use_count()) {
+			_gLog.Write(LOG_FAULT, "unknown protocol from %s: [%s]", TypePeer::ToString(peer), rcvd->rcvd.c_str());
+			client->Close();
 		}
+		else if (peer == PEER_MOUNT)        process_kv_mount       (client, base);
+		else if (peer == PEER_CAMERA)       process_kv_camera      (client, base);
+		else if (peer == PEER_MOUNT_ANNEX)  process_kv_mount_annex (client, base);
+		else if (peer == PEER_CAMERA_ANNEX) process_kv_camera_annex(client, base);
 	}
 	else {
 		client->Close();
@@ -374,15 +379,10 @@ void ObservationSystem::on_tcp_receive(const long par1, const long par2) {
 	}
 }
 
-void ObservationSystem::on_receive_kv(const long par1, const long par2) {
+void ObservationSystem::on_receive_kv(const long par1, const long par2, MessagePayload& payload) {
 	// 处理由GeneralControl投递的KV类型协议
-	// 提取队列的头信息
-	kvbase base;
-	{
-		MtxLck lck(mtx_queKv_);
-		base = queKv_.front();
-		queKv_.pop_front();
-	}
+	kvbase base = payload.Take<kvbase>();
+	if (!base.use_count()) return;
 	// 分类处理
 	string type = base->type;
 	char ch = type[0];
@@ -417,7 +417,8 @@ void ObservationSystem::on_mount_linked(const long linked, const long par2) {
 		mode = net_camera_.empty() ? OBSS_MANUAL : (robotic_ ? OBSS_AUTO : OBSS_MANUAL);
 	}
 	else {
-		_gLog.Write("Mount[%s:%s] is off-line", gid_.c_str(), uid_.c_str());
+		_gLog.Write("Mount[%s:%s] is off-line. max queueing delay of status: %.3f ms", gid_.c_str(), uid_.c_str(),
+				net_mount_.queueMaxUs * 1E-3);
 		net_mount_.Reset();
 		mode = net_camera_.empty() ? OBSS_ERROR : OBSS_MANUAL;
 	}
@@ -431,6 +432,7 @@ void ObservationSystem::on_mount_linked(const long linked, const long par2) {
 void ObservationSystem::on_mount_changed(const long old_state, const long par2) {
 	_gLog.Write("Mount<%s:%s> goes into <%s>", gid_.c_str(), uid_.c_str(),
 			StateMount::ToString(net_mount_.state));
+	publish_obss();
 
 	/* 转台工作状态变化时, 开始曝光的判定条件:
 	 * - 在执行观测计划
@@ -489,6 +491,7 @@ void ObservationSystem::on_camera_changed(const long par1, const long par2) {
 				StateObservationPlan::ToString(plan_now_->state));
 
 		plan_now_.reset();
+		publish_obss();
 		cv_acqPlan_.notify_one();
 	}
 	else if ((nFlat + nIdle) == usable_camera_) {// 平场, 重新指向
@@ -515,39 +518,85 @@ void ObservationSystem::on_switch_obsflow(const long par1, const long par2) {
 //////////////////////////////////////////////////////////////////////////////
 /* 网络通信 */
 void ObservationSystem::receive_from_peer(const TcpCPtr client, const error_code& ec, int peer) {
-	MtxLck lck(mtx_tcpRcv_);
-	TcpRcvPtr rcvd = TcpReceived::Create(client, peer, !ec);
-	que_tcpRcv_.push_back(rcvd);
-	PostMessage(MSG_TCP_RECEIVE);
+	PostMessage(MSG_TCP_RECEIVE, MessagePayload(TcpReceived::Create(client, peer, !ec)));
+}
+
+void ObservationSystem::parse_from_peer(const TcpCPtr client, char* line, int n, int peer, const SlotGroupPtr status) {
+	TcpRcvPtr rcvd = TcpReceived::Create(client, peer, true);
+	NetReadStat statRead;
+
+	if (client->CheckOverflow(statRead)) {
+		_gLog.Write(LOG_WARN, "%s sent oversized data. discarded lines: %llu, bytes: %llu; overrun bytes: %llu",
+				TypePeer::ToString(peer),
+				(unsigned long long) statRead.linesDiscarded,
+				(unsigned long long) statRead.bytesDiscarded,
+				(unsigned long long) statRead.bytesOverrun);
+	}
+	if      (peer == PEER_MOUNT)        rcvd->kv = kvProto_->ResolveMount      (line);
+	else if (peer == PEER_CAMERA)       rcvd->kv = kvProto_->ResolveCamera     (line);
+	else if (peer == PEER_MOUNT_ANNEX)  rcvd->kv = kvProto_->ResolveMountAnnex (line);
+	else if (peer == PEER_CAMERA_ANNEX) rcvd->kv = kvProto_->ResolveCameraAnnex(line);
+	if (rcvd->kv.use_count()) rcvd->kv->arrival = client->ArrivalTime();
+	else rcvd->rcvd.assign(line, n);
+	if (rcvd->IsStatus()) {// 只合并同一设备的状态
+		SlotPtr slot = status->Find(rcvd->StatusKey());
+		PostMessage(MSG_TCP_RECEIVE, slot, MessagePayload(std::move(rcvd)));
+	}
+	else {
+		status->Seal();	// 其后的状态不再并入已排队的状态, 保持与本条信息的顺序
+		PostMessage(MSG_TCP_RECEIVE, MessagePayload(std::move(rcvd)));
+	}
 }
 
-void ObservationSystem::resolve_kv_mount(const TcpCPtr client) {
-	kvbase base = kvProto_->ResolveMount(bufTcp_.get());
+void ObservationSystem::process_kv_mount(const TcpCPtr client, kvbase base) {
 	if (iequals(base->type, KVTYPE_MOUNT)) {// 转台状态
+		kvmount proto = from_kvbase<kv_proto_mount>(base);
 		int old_state(net_mount_.state);
-		net_mount_ = from_kvbase<kv_proto_mount>(base);
+		int n;
+		const char* data;
+		net_mount_ = proto;
 		if (old_state != net_mount_.state)
 			PostMessage(MSG_MOUNT_CHANGED, old_state);
+		data = kvProto_->CompactMount(proto, n);
+		notify_client_status(base->type, "", data, n);
 	}
 }
 
-void ObservationSystem::resolve_kv_camera(const TcpCPtr client) {
-	kvbase base = kvProto_->ResolveCamera(bufTcp_.get());
+void ObservationSystem::process_kv_camera(const TcpCPtr client, kvbase base) {
 	if (iequals(base->type, KVTYPE_CAMERA)) {// 相机状态
+		kvcamera proto = from_kvbase<kv_proto_camera>(base);
 		NetCamPtr cam = find_camera(client);
 		int old_state(cam->state);
-		*cam = from_kvbase<kv_proto_camera>(base);
+		int n;
+		const char* data;
+		*cam = proto;
 		if (cam->enabled && old_state != cam->state && plan_now_.use_count())
 			PostMessage(MSG_CAMERA_CHANGED);
+		data = kvProto_->CompactCamera(proto, n);
+		notify_client_status(base->type, cam->cid, data, n);
+		if (old_state != cam->state) publish_obss();
 	}
 }
 
-void ObservationSystem::resolve_kv_mount_annex(const TcpCPtr client) {
+void ObservationSystem::process_kv_mount_annex(const TcpCPtr client, kvbase base) {
+
+}
+
+void ObservationSystem::process_kv_camera_annex(const TcpCPtr client, kvbase base) {
 
 }
 
-void ObservationSystem::resolve_kv_camera_annex(const TcpCPtr client) {
+void ObservationSystem::notify_client_status(const string& type, const string& cid, const char* data, int n) {
+	if (mcast_.use_count()) mcast_->Publish(data, n);
+
+	MtxLck lck(mtx_client_);
+	if (tcpc_client_.empty()) return;
 
+	string key = type + ":" + gid_ + ":" + uid_ + ":" + cid;
+	TcpMsgPtr msg = TcpClient::CreateMessage(data, n);
+	for (TcpCVec::iterator it = tcpc_client_.begin(); it != tcpc_client_.end(); ++it) {
+		if ((*it)->IsOpen()) (*it)->Write(msg, TCPMSG_STATUS, key);
+	}
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -595,7 +644,7 @@ void ObservationSystem::process_disable(const string& cid) {
 				if ((*it)->state > StateCameraControl::CAMCTL_IDLE) {
 					int n;
 					const char* data = kvProto_->CompactExpose(CommandExpose::EXP_STOP, n);
-					(**it)()->Write(data, n);
+					(**it)()->Write(data, n, TCPMSG_COMMAND);
 				}
 			}
 		}
@@ -615,7 +664,7 @@ void ObservationSystem::process_findhome() {
 #else  // 通用
 		data = kvProto_->CompactFindHome(gid_, uid_, n);
 #endif
-		net_mount_()->Write(data, n);
+		net_mount_()->Write(data, n, TCPMSG_COMMAND);
 	}
 }
 
@@ -635,7 +684,7 @@ void ObservationSystem::process_slewto(kvslewto proto) {
 		const char* data;
 		net_mount_.BeginSlew(proto->coorsys, proto->lon, proto->lat);
 		data = kvProto_->CompactSlewto(proto, n);
-		net_mount_()->Write(data, n);
+		net_mount_()->Write(data, n, TCPMSG_COMMAND);
 	}
 }
 
@@ -662,7 +711,7 @@ void ObservationSystem::process_homesync(kvhomesync proto) {
 #else
 		data = kvProto_->CompactHomeSync(gid_, uid_, proto->ra, proto->dec, n);
 #endif
-		net_mount_()->Write(data, n);
+		net_mount_()->Write(data, n, TCPMSG_COMMAND);
 	}
 	else {
 		_gLog.Write(LOG_WARN, "Home sync mount[%s:%s] is rejected",
@@ -682,7 +731,7 @@ void ObservationSystem::process_park() {
 #else
 		data = kvProto_->CompactPark(gid_, uid_, n);
 #endif
-		net_mount_()->Write(data, n);
+		net_mount_()->Write(data, n, TCPMSG_COMMAND);
 	}
 	else {
 		_gLog.Write(LOG_WARN, "Parking mount[%s:%s] is rejected",
@@ -696,12 +745,13 @@ void ObservationSystem::process_take_image(kvtakeimg proto) {
 	bool matched(false);
 	int n;
 	const char* data = kvProto_->CompactTakeImage(proto, n);
+	TcpMsgPtr msg = TcpClient::CreateMessage(data, n);
 
 	for (NetCamVec::iterator it = net_camera_.begin(); it != net_camera_.end(); ++it) {
 		if ((*it)->enabled
 				&& (cid.empty() || (matched = iequals(cid, (*it)->cid)))
 				&& (*it)->state == StateCameraControl::CAMCTL_IDLE) {
-			(**it)()->Write(data, n);
+			(**it)()->Write(msg, TCPMSG_COMMAND);
 		}
 		else {
 			_gLog.Write(LOG_WARN, "take_image[%s:%s:%s] is rejected",
@@ -715,12 +765,13 @@ void ObservationSystem::process_abort_image(const string& cid) {
 	bool matched(false);
 	int n;
 	const char* data = kvProto_->CompactExpose(CommandExpose::EXP_STOP, n);
+	TcpMsgPtr msg = TcpClient::CreateMessage(data, n);
 
 	for (NetCamVec::iterator it = net_camera_.begin(); it != net_camera_.end(); ++it) {
 		if ((*it)->enabled
 				&& (cid.empty() || (matched = iequals(cid, (*it)->cid)))
 				&& (*it)->state > StateCameraControl::CAMCTL_IDLE) {
-			(**it)()->Write(data, n);
+			(**it)()->Write(msg, TCPMSG_COMMAND);
 		}
 		else {
 			_gLog.Write(LOG_WARN, "abort_image[%s:%s:%s] is rejected",
@@ -778,7 +829,33 @@ void ObservationSystem::switch_runmode(int mode) {
 						: (mode == OBSS_MANUAL ? "MANUAL" : "AUTO"));
 		mode_run_ = mode;
 		PostMessage(MSG_SWITCH_OBSFLOW);
+		publish_obss();
+	}
+}
+
+void ObservationSystem::publish_obss() {
+	if (!mcast_.use_count()) return;
+
+	kvobss proto = boost::make_shared<kv_proto_obss>();
+	ObsPlanItemPtr plan = plan_now_;
+	const char* data;
+	int n;
+
+	proto->gid   = gid_;
+	proto->uid   = uid_;
+	proto->state = mode_run_;
+	if (plan.use_count()) proto->plan_sn = plan->plan_sn;
+	proto->mount = net_mount_.state;
+	{
+		MtxLck lck(mtx_camera_);
+		kv_proto_obss::camera_state cs;
+		for (NetCamVec::iterator it = net_camera_.begin(); it != net_camera_.end(); ++it) {
+			cs.cid   = (*it)->cid;
+			cs.state = (*it)->state;
+			proto->camera.push_back(cs);
+		}
 	}
+	if ((data = kvProto_->CompactObss(proto, n))) mcast_->Publish(data, n);
 }
 
 ObservationSystem::NetCamPtr ObservationSystem::find_camera(const string& cid) {
@@ -877,10 +954,11 @@ void ObservationSystem::process_expose(int cmd, bool just_guide) {
 	MtxLck lck(mtx_camera_);
 	int n;
 	const char* data = kvProto_->CompactExpose(cmd, n);
+	TcpMsgPtr msg = TcpClient::CreateMessage(data, n);
 	bool matched(false);
 	for (NetCamVec::iterator it = net_camera_.begin(); it != net_camera_.end() && !matched; ++it) {
 		if (!just_guide || (matched = (std::stoi((*it)->cid) % 5) == 0))
-			(*it)->client->Write(data, n);
+			(*it)->client->Write(msg, TCPMSG_COMMAND);
 	}
 }
 
@@ -896,6 +974,7 @@ void ObservationSystem::thread_acquire_plan() {
 		if (!(plan_now_.use_count() || plan_wait_.use_count())) {
 			plan_now_ = *acqPlan_(shared_from_this());
 			if (plan_now_.use_count()) {
+				publish_obss();
 				//...开始执行计划
 			}
 		}
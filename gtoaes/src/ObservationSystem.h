@@ -4,13 +4,21 @@
  * @version 1.0
  * @date 2020-11-08
  * @author 卢晓猛
+ * @version 1.1
+ * @date 2026-10-17
+ * - 转发设备状态时同时以组播发布; 工作模式、设备状态或在执行计划变化时组播观测系统状态
+ * - P2P设备的网络信息在连接所属I/O线程中解析, 消息队列只处理解析后的协议
+ * - 转台与相机状态记录到达时间与排队延迟. GWAC转台以到达时间计算地平坐标
+ * - 网络事件与被投递的协议随消息传递, 不再经由另行加锁的队列
+ * - 转台与相机的实时状态可合并: 消息队列只处理同一设备的最新状态.
+ *   同一连接的其它信息入队后不再合并, 保持连接内的信息顺序
+ * - 转台与相机的状态变化消息逐次投递, 不合并
  */
 
 #ifndef OBSERVATIONSYSTEM_H_
 #define OBSERVATIONSYSTEM_H_
 
 #include <math.h>
-#include <deque>
 #include <boost/enable_shared_from_this.hpp>
 #include "MessageQueue.h"
 #include "ATimeSpace.h"
@@ -23,6 +31,7 @@
 #include "DatabaseCurl.h"
 #include "DomeSlit.h"
 #include "TcpReceived.h"
+#include "StatusMulticast.h"
 
 class ObservationSystem
 		: public boost::enable_shared_from_this<ObservationSystem>
@@ -34,8 +43,6 @@ public:
 	/* 数据类型 */
 public:
 	using Pointer = boost::shared_ptr<ObservationSystem>;
-	using KvProtoQue = std::deque<kvbase>;
-	using NonkvProtoQue = std::deque<nonkvbase>;
 
 	/*!
 	 * @brief 回调函数, 尝试从队列里获取可用的观测计划
@@ -61,7 +68,38 @@ public:
 	};
 
 protected:
-	struct NetworkMount {
+	/*!
+	 * @struct SampleTime
+	 * @brief 设备状态的采样时间: 到达时间与从到达至处理的排队延迟
+	 */
+	struct SampleTime {
+		int64_t arrival;	///< 最后一次状态的到达时间: UTC, 自1970-01-01起的纳秒数. 0: 未知
+		int queueUs;		///< 最后一次状态的排队延迟, 量纲: 微秒
+		int queueMaxUs;		///< 最大排队延迟, 量纲: 微秒
+
+	public:
+		SampleTime() {
+			ClearSample();
+		}
+
+		void ClearSample() {
+			arrival = 0;
+			queueUs = queueMaxUs = 0;
+		}
+
+		/*!
+		 * @brief 记录状态的到达时间
+		 * @param t  到达时间. 0: 未知, 不记录
+		 */
+		void Stamp(int64_t t) {
+			if (!t) return;
+			arrival = t;
+			queueUs = int((TcpClient::RealTime() - t) / 1000);
+			if (queueUs > queueMaxUs) queueMaxUs = queueUs;
+		}
+	};
+
+	struct NetworkMount : public SampleTime {
 		TcpCPtr client;		///< 网络连接
 		bool kvtype;		///< 通信协议类型
 		int state;			///< 工作状态
@@ -104,6 +142,7 @@ protected:
 		void Reset() {
 			client.reset();
 			state = -1;
+			ClearSample();
 		}
 
 		bool IsOpen() {
@@ -182,6 +221,7 @@ protected:
 			dec = proto->dec;
 			azi = proto->azi;
 			alt = proto->alt;
+			Stamp(proto->arrival);
 
 			return *this;
 		}
@@ -210,6 +250,7 @@ protected:
 			dec = proto->dec;
 			azi = proto->azi;
 			alt = proto->alt;
+			Stamp(proto->arrival);
 
 			return *this;
 		}
@@ -243,7 +284,7 @@ protected:
 		}
 	};
 
-	struct NetworkCamera {
+	struct NetworkCamera : public SampleTime {
 		using Pointer = boost::shared_ptr<NetworkCamera>;
 
 		TcpCPtr client;		///< 网络连接
@@ -301,6 +342,7 @@ protected:
 			errcode = proto->errcode;
 			coolget = proto->coolget;
 			filter  = proto->filter;
+			Stamp(proto->arrival);
 
 			return *this;
 		}
@@ -349,16 +391,8 @@ protected:
 	boost::mutex mtx_client_;	///< 互斥锁: 客户端
 
 	/* 网络通信 */
-	boost::shared_array<char> bufTcp_;	///< 网络信息存储区: 消息队列中调用
-	KvProtoPtr kvProto_;		///< 键值对格式协议访问接口
+	KvProtoPtr kvProto_;		///< 键值对格式协议访问接口. 解析在I/O线程中调用
 	NonkvProtoPtr nonkvProto_;	///< 非键值对格式协议访问接口
-	boost::mutex mtx_queKv_;	///< 互斥锁: 键值对协议队列
-	boost::mutex mtx_queNonkv_;	///< 互斥锁: 非键值对协议队列
-
-	TcpRcvQue que_tcpRcv_;		///< 网络事件队列
-	KvProtoQue queKv_;			///< 被投递的键值对协议队列
-	NonkvProtoQue queNonkv_;	///< 被投递的非键值对协议队列
-	boost::mutex mtx_tcpRcv_;	///< 互斥锁: 网络事件
 
 	/* 观测计划 */
 	ObsPlanPtr obsPlans_;		///< 观测计划集合, 维护定标用的观测计划
@@ -370,6 +404,9 @@ protected:
 	/* 数据库 */
 	DBCurlPtr dbPtr_;	///< 数据库访问接口
 
+	/* 状态组播 */
+	McastPtr mcast_;	///< 实时状态组播接口. 未启用时为空
+
 	/* 多线程 */
 	ThreadPtr thrd_acqPlan_;	///< 线程: 尝试获取观测计划
 	ThreadPtr thrd_calPlan_;	///< 线程: 生成定标观测计划
@@ -403,6 +440,11 @@ public:
 	 * @brief 设置数据库访问接口
 	 */
 	void SetDBPtr(DBCurlPtr ptr);
+	/*!
+	 * @brief 设置实时状态组播接口
+	 * @param ptr  组播接口. 为空时不发布
+	 */
+	void SetMulticast(McastPtr ptr);
 	/*!
 	 * @brief 注册回调函数: 请求新的观测计划
 	 * @param slot  插槽函数
@@ -574,18 +616,20 @@ protected:
 	void register_messages();
 	/*!
 	 * @brief 消息: 收到TCP信息
-	 * @param par1  参数1, 保留
-	 * @param par2  参数2, 保留
+	 * @param par1     参数1, 保留
+	 * @param par2     参数2, 保留
+	 * @param payload  网络事件, TcpRcvPtr
 	 * @note
 	 * P2P模式设备收到的信息
 	 */
-	void on_tcp_receive(const long par1, const long par2);
+	void on_tcp_receive(const long par1, const long par2, MessagePayload& payload);
 	/*!
 	 * @brief 消息: 收到KV类型信息
-	 * @param par1  参数1, 保留
-	 * @param par2  参数2, 保留
+	 * @param par1     参数1, 保留
+	 * @param par2     参数2, 保留
+	 * @param payload  键值对协议, kvbase
 	 */
-	void on_receive_kv(const long par1, const long par2);
+	void on_receive_kv(const long par1, const long par2, MessagePayload& payload);
 	/*!
 	 * @brief 消息: 收到Non-KV类型信息
 	 * @param par1  参数1, 保留
@@ -611,7 +655,7 @@ protected:
 	 */
 	void on_camera_linked(const long linked, const long par2);
 	/*!
-	 * @brief 消息: 转台工作状态变化
+	 * @brief 消息: 相机工作状态变化
 	 * @param par1  保留
 	 * @param par2  保留
 	 */
@@ -639,25 +683,45 @@ protected:
 	 */
 	void receive_from_peer(const TcpCPtr client, const error_code& ec, int peer);
 	/*!
-	 * @brief  解析处理转台的键值对协议
-	 * @param client  网络连接
-	 */
-	void resolve_kv_mount(const TcpCPtr client);
-	/*!
-	 * @brief  解析处理相机的键值对协议
-	 * @param client  网络连接
-	 */
-	void resolve_kv_camera(const TcpCPtr client);
-	/*!
-	 * @brief  解析处理转台附属设备的键值对协议
+	 * @brief 在I/O线程中解析一条网络信息, 并投递解析结果
+	 * @param client 网络连接
+	 * @param line   信息. 不含换行符, 以0结尾
+	 * @param n      信息长度
+	 * @param peer   远程主机类型
+	 * @param status 连接绑定的暂存单元集合, 按设备合并实时状态
+	 */
+	void parse_from_peer(const TcpCPtr client, char* line, int n, int peer, const SlotGroupPtr status);
+	/*!
+	 * @fn process_kv_mount
+	 * @brief   处理转台的键值对协议
+	 * @fn process_kv_camera
+	 * @brief   处理相机的键值对协议
+	 * @fn process_kv_mount_annex
+	 * @brief   处理转台附属设备的键值对协议
+	 * @fn process_kv_camera_annex
+	 * @brief   处理相机附属设备的键值对协议
+	 *
 	 * @param client  网络连接
+	 * @param base    通信协议
+	 */
+	void process_kv_mount       (const TcpCPtr client, kvbase base);
+	void process_kv_camera      (const TcpCPtr client, kvbase base);
+	void process_kv_mount_annex (const TcpCPtr client, kvbase base);
+	void process_kv_camera_annex(const TcpCPtr client, kvbase base);
+	/*!
+	 * @brief 向关联客户端转发设备状态
+	 * @param type  协议类型
+	 * @param cid   相机编号. 转台状态为空
+	 * @param data  状态信息
+	 * @param n     信息长度
+	 * @note
+	 * 客户端发送队列中同一设备的未发送状态只保留最新值
 	 */
-	void resolve_kv_mount_annex (const TcpCPtr client);
+	void notify_client_status(const string& type, const string& cid, const char* data, int n);
 	/*!
-	 * @brief  解析处理相机附属设备的键值对协议
-	 * @param client  网络连接
+	 * @brief 以组播发布观测系统状态: 工作模式、在执行计划、转台与相机状态
 	 */
-	void resolve_kv_camera_annex(const TcpCPtr client);
+	void publish_obss();
 
 protected:
 	//////////////////////////////////////////////////////////////////////////////
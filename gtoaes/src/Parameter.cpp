@@ -23,11 +23,29 @@ void Parameter::Init(const char* filepath) {
 
 	ptree &node1 = pt.add("Server", "");
 	node1.add("Client.<xmlattr>.Port",       4010);
+	node1.add("Client.<xmlattr>.Unix",       "");
 	node1.add("Mount.<xmlattr>.Port",        4011);
+	node1.add("Mount.<xmlattr>.Unix",        "");
 	node1.add("Camera.<xmlattr>.Port",       4012);
+	node1.add("Camera.<xmlattr>.Unix",       "");
 	node1.add("MountAnnex.<xmlattr>.Port",   4013);
+	node1.add("MountAnnex.<xmlattr>.Unix",   "");
 	node1.add("CameraAnnex.<xmlattr>.Port",  4014);
+	node1.add("CameraAnnex.<xmlattr>.Unix",  "");
 	node1.add("Environment.<xmlattr>.Port",  4015);
+	node1.add("IOService.<xmlattr>.Threads", 0);
+	node1.add("Line.<xmlattr>.MaxLength",    4096);
+	node1.add("Acceptor.<xmlattr>.Shards",   1);
+	node1.add("IdleTimeout.<xmlattr>.Client",      0);
+	node1.add("IdleTimeout.<xmlattr>.Mount",       10);
+	node1.add("IdleTimeout.<xmlattr>.Camera",      10);
+	node1.add("IdleTimeout.<xmlattr>.MountAnnex",  0);
+	node1.add("IdleTimeout.<xmlattr>.CameraAnnex", 0);
+	node1.add("Multicast.<xmlattr>.Enable",    false);
+	node1.add("Multicast.<xmlattr>.Group",     "239.192.0.1");
+	node1.add("Multicast.<xmlattr>.Port",      4016);
+	node1.add("Multicast.<xmlattr>.TTL",       1);
+	node1.add("Multicast.<xmlattr>.Interface", "");
 
 	ptree &node2 = pt.add("NTP", "");
 	node2.add("<xmlattr>.Enable",			false);
@@ -88,6 +106,12 @@ void Parameter::Init(const char* filepath) {
 
 const char* Parameter::Load(const char* filepath) {
 
+	ioThreads = 0;
+	maxLine   = 4096;
+	acceptShards = 1;
+	timeoutClient = timeoutMountAnnex = timeoutCameraAnnex = 0;
+	timeoutMount  = timeoutCamera = 10;
+	mcastEnable = false;
 	try {
 		ptree pt;
 		read_xml(filepath, pt, xml_parser::trim_whitespace);
@@ -99,7 +123,25 @@ const char* Parameter::Load(const char* filepath) {
 				portCamera		= x.second.get("Camera.<xmlattr>.Port",       4012);
 				portMountAnnex	= x.second.get("MountAnnex.<xmlattr>.Port",   4013);
 				portCameraAnnex	= x.second.get("CameraAnnex.<xmlattr>.Port",  4014);
+				unixClient		= x.second.get("Client.<xmlattr>.Unix",       "");
+				unixMount		= x.second.get("Mount.<xmlattr>.Unix",        "");
+				unixCamera		= x.second.get("Camera.<xmlattr>.Unix",       "");
+				unixMountAnnex	= x.second.get("MountAnnex.<xmlattr>.Unix",   "");
+				unixCameraAnnex	= x.second.get("CameraAnnex.<xmlattr>.Unix",  "");
 				portEnv			= x.second.get("Environment.<xmlattr>.Port",  4015);
+				ioThreads		= x.second.get("IOService.<xmlattr>.Threads", 0);
+				maxLine			= x.second.get("Line.<xmlattr>.MaxLength",    4096);
+				acceptShards	= x.second.get("Acceptor.<xmlattr>.Shards",   1);
+				timeoutClient		= x.second.get("IdleTimeout.<xmlattr>.Client",      0);
+				timeoutMount		= x.second.get("IdleTimeout.<xmlattr>.Mount",       10);
+				timeoutCamera		= x.second.get("IdleTimeout.<xmlattr>.Camera",      10);
+				timeoutMountAnnex	= x.second.get("IdleTimeout.<xmlattr>.MountAnnex",  0);
+				timeoutCameraAnnex	= x.second.get("IdleTimeout.<xmlattr>.CameraAnnex", 0);
+				mcastEnable		= x.second.get("Multicast.<xmlattr>.Enable",    false);
+				mcastGroup		= x.second.get("Multicast.<xmlattr>.Group",     "239.192.0.1");
+				mcastPort		= x.second.get("Multicast.<xmlattr>.Port",      4016);
+				mcastTTL		= x.second.get("Multicast.<xmlattr>.TTL",       1);
+				mcastIface		= x.second.get("Multicast.<xmlattr>.Interface", "");
 			}
 			else if (iequals(x.first, "NTP")) {
 				ntpEnable	= x.second.get("<xmlattr>.Enable",        false);
@@ -86,6 +86,31 @@ public:
 	int portMountAnnex;	///< TCP服务端口: 转台附属
 	int portCameraAnnex;///< TCP服务端口: 相机附属
 	int portEnv;		///< UDP服务端口: 气象环境
+	/* 本地(AF_UNIX)套接口路径. 为空时不使用; 对应TCP端口<= 0时只使用本地套接口 */
+	string unixClient;		///< 客户端
+	string unixMount;		///< 转台
+	string unixCamera;		///< 相机
+	string unixMountAnnex;	///< 转台附属
+	string unixCameraAnnex;	///< 相机附属
+
+	/* 网络I/O */
+	int ioThreads;		///< 执行网络I/O的线程数量. <= 0时使用CPU核数
+	int maxLine;		///< 网络信息最大长度, 量纲: 字节. 超长信息被丢弃
+	int acceptShards;	///< 每个TCP服务端口的监听套接口数量. > 1时使用SO_REUSEPORT; <= 0时等于I/O线程数量
+
+	/* 网络连接空闲超时, 量纲: 秒. 超时后关闭连接; <= 0时不检查 */
+	int timeoutClient;		///< 客户端
+	int timeoutMount;		///< 转台
+	int timeoutCamera;		///< 相机
+	int timeoutMountAnnex;	///< 转台附属
+	int timeoutCameraAnnex;	///< 相机附属
+
+	/* 以UDP组播发布实时状态 */
+	bool mcastEnable;	///< 启用组播
+	string mcastGroup;	///< 组播组地址
+	int mcastPort;		///< 组播端口
+	int mcastTTL;		///< 组播TTL. 1: 仅局域网
+	string mcastIface;	///< 发送组播的本机网络接口地址. 为空时由系统选择
 
 	/* NTP时间服务器 */
 	bool ntpEnable;		///< 启用NTP
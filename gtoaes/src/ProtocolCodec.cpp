@@ -0,0 +1,67 @@
+/**
+ * @file ProtocolCodec.cpp
+ * @brief 网络连接的协议编解码器: 由首条信息识别协议格式, 之后直接调用对应的解析接口
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#include <string.h>
+#include <boost/chrono/chrono.hpp>
+#include "ProtocolCodec.h"
+#include "AstroDeviceDef.h"
+
+using namespace boost::chrono;
+
+static const char NONKV_PREFIX[] = "g#";	///< 非键值对格式的引导符
+
+ProtocolCodec::ProtocolCodec(KvProtoPtr kvProto, NonkvProtoPtr nonkvProto, int peer, CodecStat* stat) {
+	kvProto_    = kvProto;
+	nonkvProto_ = nonkvProto;
+	stat_       = stat;
+	peer_       = peer;
+	type_       = CODEC_NONE;
+
+	if      (peer == PEER_MOUNT)        resolveKv_ = &KvProtocol::ResolveMount;
+	else if (peer == PEER_CAMERA)       resolveKv_ = &KvProtocol::ResolveCamera;
+	else if (peer == PEER_MOUNT_ANNEX)  resolveKv_ = &KvProtocol::ResolveMountAnnex;
+	else if (peer == PEER_CAMERA_ANNEX) resolveKv_ = &KvProtocol::ResolveCameraAnnex;
+	else                                resolveKv_ = &KvProtocol::ResolveClient;
+}
+
+bool ProtocolCodec::Decode(const char* line, TcpReceived& rcvd) {
+	if (type_ == CODEC_NONE) detect(line);
+	if (decode(type_, line, rcvd)) return true;
+
+	// 误检: 另一格式可以解析时切换格式
+	int other = type_ == CODEC_KV ? CODEC_NONKV : CODEC_KV;
+	if (!decode(other, line, rcvd)) return false;
+	type_ = other;
+	++stat_->mismatch;
+	return true;
+}
+
+void ProtocolCodec::detect(const char* line) {
+	steady_clock::time_point start = steady_clock::now();
+
+	if (strstr(line, NONKV_PREFIX)) {
+		type_ = CODEC_NONKV;
+		++stat_->nonkv;
+	}
+	else {
+		type_ = CODEC_KV;
+		++stat_->kv;
+	}
+	stat_->detectNs += duration_cast<nanoseconds>(steady_clock::now() - start).count();
+}
+
+bool ProtocolCodec::decode(int type, const char* line, TcpReceived& rcvd) {
+	if (type == CODEC_KV) {
+		rcvd.kv = ((*kvProto_).*resolveKv_)(line);
+		return rcvd.kv.use_count();
+	}
+	// 非键值对格式: 引导符通常位于行首
+	const char* ptr = strstr(line, NONKV_PREFIX);
+	if (!ptr) return false;
+	rcvd.nonkv = nonkvProto_->Resove(ptr + sizeof(NONKV_PREFIX) - 1);
+	return rcvd.nonkv.use_count();
+}
@@ -0,0 +1,108 @@
+/**
+ * @file ProtocolCodec.h
+ * @brief 网络连接的协议编解码器: 由首条信息识别协议格式, 之后直接调用对应的解析接口
+ * @version 0.1
+ * @date 2026-10-17
+ * @note
+ * - 每个网络连接一个实例, 绑定在连接的信息回调中, 只在连接所属I/O线程中调用
+ * - 首条完整信息含"g#"时识别为非键值对格式, 否则为键值对格式. 键值对格式的解析接口按主机类型在构造时选定
+ * - 已识别格式无法解析而另一格式可以解析时, 记为误检并切换格式
+ * - 识别次数、识别耗时与误检次数累计在CodecStat中, 由使用者定期输出
+ */
+
+#ifndef SRC_PROTOCOLCODEC_H_
+#define SRC_PROTOCOLCODEC_H_
+
+#include <atomic>
+#include <stdint.h>
+#include <boost/smart_ptr/shared_ptr.hpp>
+#include "KvProtocol.h"
+#include "NonkvProtocol.h"
+#include "TcpReceived.h"
+
+/*!
+ * @struct CodecStat
+ * @brief 协议识别统计. 多个I/O线程共用
+ */
+struct CodecStat {
+	std::atomic<uint64_t> kv;		///< 识别为键值对格式的连接数量
+	std::atomic<uint64_t> nonkv;	///< 识别为非键值对格式的连接数量
+	std::atomic<uint64_t> mismatch;	///< 误检次数
+	std::atomic<uint64_t> detectNs;	///< 识别累计耗时, 量纲: 纳秒
+
+public:
+	CodecStat() : kv(0), nonkv(0), mismatch(0), detectNs(0) {
+	}
+};
+
+class ProtocolCodec {
+public:
+	using Pointer = boost::shared_ptr<ProtocolCodec>;
+	/*!
+	 * @brief 协议格式
+	 */
+	enum {
+		CODEC_NONE,	///< 未识别
+		CODEC_KV,	///< 键值对格式
+		CODEC_NONKV	///< 非键值对格式, 以"g#"引导
+	};
+
+protected:
+	using KvResolve = kvbase (KvProtocol::*)(const char*);	//< 键值对格式解析接口
+
+protected:
+	/* 成员变量 */
+	KvProtoPtr kvProto_;		//< 键值对格式协议访问接口
+	NonkvProtoPtr nonkvProto_;	//< 非键值对格式协议访问接口
+	KvResolve resolveKv_;		//< 按主机类型选定的键值对格式解析接口
+	CodecStat* stat_;			//< 统计
+	int peer_;					//< 主机类型
+	int type_;					//< 已识别的协议格式
+
+public:
+	/*!
+	 * @param kvProto     键值对格式协议访问接口
+	 * @param nonkvProto  非键值对格式协议访问接口
+	 * @param peer        主机类型
+	 * @param stat        统计
+	 */
+	ProtocolCodec(KvProtoPtr kvProto, NonkvProtoPtr nonkvProto, int peer, CodecStat* stat);
+	static Pointer Create(KvProtoPtr kvProto, NonkvProtoPtr nonkvProto, int peer, CodecStat* stat) {
+		return Pointer(new ProtocolCodec(kvProto, nonkvProto, peer, stat));
+	}
+	/*!
+	 * @brief 查看主机类型
+	 */
+	int Peer() const {
+		return peer_;
+	}
+	/*!
+	 * @brief 查看已识别的协议格式
+	 */
+	int Type() const {
+		return type_;
+	}
+	/*!
+	 * @brief 解析一条信息
+	 * @param line   信息. 以0结尾
+	 * @param rcvd   解析结果存储在kv或nonkv中
+	 * @return
+	 * 解析结果
+	 */
+	bool Decode(const char* line, TcpReceived& rcvd);
+
+protected:
+	/*!
+	 * @brief 由首条信息识别协议格式, 并累计识别耗时
+	 */
+	void detect(const char* line);
+	/*!
+	 * @brief 按指定格式解析
+	 * @return
+	 * 解析结果
+	 */
+	bool decode(int type, const char* line, TcpReceived& rcvd);
+};
+using CodecPtr = ProtocolCodec::Pointer;
+
+#endif /* SRC_PROTOCOLCODEC_H_ */
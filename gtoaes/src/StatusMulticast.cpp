@@ -0,0 +1,86 @@
+/**
+ * @file StatusMulticast.cpp
+ * @brief 以UDP组播发布转台、相机与观测系统实时状态
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <boost/asio/ip/multicast.hpp>
+#include "StatusMulticast.h"
+
+using namespace boost::asio;
+
+StatusMulticast::StatusMulticast()
+	: sock_(AsioIOServicePool::Instance().GetIOService()) {
+	seq_    = 0;
+	failed_ = 0;
+}
+
+StatusMulticast::~StatusMulticast() {
+	Close();
+}
+
+bool StatusMulticast::Open(const string& group, uint16_t port, int ttl, const string& iface) {
+	error_code ec;
+	ip::address addr = ip::address::from_string(group, ec);
+	if (ec || !addr.is_multicast()) return false;
+
+	MtxLck lck(mtx_);
+	group_ = UDP::endpoint(addr, port);
+	sock_.open(group_.protocol(), ec);
+	if (!ec) sock_.non_blocking(true, ec);
+	if (!ec) sock_.set_option(ip::multicast::hops(ttl > 0 ? ttl : 1), ec);
+	if (!ec) sock_.set_option(ip::multicast::enable_loopback(true), ec);
+	if (!ec && iface.size() && addr.is_v4()) {
+		ip::address_v4 local = ip::address_v4::from_string(iface, ec);
+		if (!ec) sock_.set_option(ip::multicast::outbound_interface(local), ec);
+	}
+	if (ec && sock_.is_open()) sock_.close(ec);
+	return sock_.is_open();
+}
+
+void StatusMulticast::Close() {
+	MtxLck lck(mtx_);
+	if (sock_.is_open()) {
+		error_code ec;
+		sock_.close(ec);
+	}
+}
+
+bool StatusMulticast::IsOpen() {
+	return sock_.is_open();
+}
+
+void StatusMulticast::Publish(const char* data, int n) {
+	if (!data || n <= 0) return;
+
+	const char* sep = (const char*) memchr(data, ' ', n);
+	int ntype = sep ? sep - data : (data[n - 1] == '\n' ? n - 1 : n);
+	int nkv   = sep ? n - ntype - 1 : 0;	// 键值对长度, 含结束符
+
+	MtxLck lck(mtx_);
+	if (!sock_.is_open()) return;
+	if (ntype + nkv + 16 > UDP_PACK_SIZE) {// 超长: 丢弃, 但仍占用序号, 使接收方可以察觉
+		++seq_;
+		++failed_;
+		return;
+	}
+	// 组装数据报: <type> seq=<n>,<键值对>
+	memcpy(buff_, data, ntype);
+	int len = ntype + sprintf(buff_ + ntype, nkv ? " seq=%u," : " seq=%u\n", seq_++);
+	if (nkv) {
+		memcpy(buff_ + len, sep + 1, nkv);
+		len += nkv;
+	}
+
+	error_code ec;
+	sock_.send_to(buffer(buff_, len), group_, 0, ec);
+	if (ec) ++failed_;
+}
+
+uint64_t StatusMulticast::Failed() {
+	MtxLck lck(mtx_);
+	return failed_;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file StatusMulticast.h
+ * @brief 以UDP组播发布转台、相机与观测系统实时状态
+ * @version 0.1
+ * @date 2026-10-17
+ * @note
+ * - 每个状态对应一个数据报, 内容为键值对格式协议(mount/camera/obss)
+ * - 在协议类型之后插入键seq. 序号全局递增, 接收方据此检测丢包
+ * - 套接口工作在非阻塞模式. 发送失败时丢弃数据报, 不阻塞调用线程
+ * - 只读的状态监视程序加入组播组即可接收, 发送开销与接收方数量无关
+ */
+
+#ifndef SRC_STATUSMULTICAST_H_
+#define SRC_STATUSMULTICAST_H_
+
+#include <string>
+#include <stdint.h>
+#include <boost/asio/ip/udp.hpp>
+#include <boost/smart_ptr/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/lock_types.hpp>
+#include "AsioUDP.h"
+
+using std::string;
+
+class StatusMulticast {
+public:
+	StatusMulticast();
+	virtual ~StatusMulticast();
+
+public:
+	using Pointer = boost::shared_ptr<StatusMulticast>;
+	using UDP = boost::asio::ip::udp;
+	using MtxLck = boost::unique_lock<boost::mutex>;
+
+protected:
+	/* 成员变量 */
+	UDP::socket sock_;		///< 套接口
+	UDP::endpoint group_;	///< 组播组地址
+	uint32_t seq_;			///< 下一个数据报序号
+	uint64_t failed_;		///< 发送失败或超长而被丢弃的数据报数量
+	char buff_[UDP_PACK_SIZE + 32];	///< 数据报组装缓冲区
+	boost::mutex mtx_;		///< 互斥锁: 序号与发送
+
+public:
+	static Pointer Create() {
+		return Pointer(new StatusMulticast);
+	}
+	/*!
+	 * @brief 打开套接口
+	 * @param group  组播组IP地址
+	 * @param port   组播端口
+	 * @param ttl    组播TTL. 1: 仅局域网
+	 * @param iface  发送组播的本机网络接口IPv4地址. 为空时由系统选择
+	 * @return
+	 * 打开结果
+	 */
+	bool Open(const string& group, uint16_t port, int ttl = 1, const string& iface = "");
+	/*!
+	 * @brief 关闭套接口
+	 */
+	void Close();
+	/*!
+	 * @brief 检查套接口是否已经打开
+	 */
+	bool IsOpen();
+	/*!
+	 * @brief 发布状态
+	 * @param data  键值对格式协议, 由KvProtocol::CompactXXX()生成
+	 * @param n     协议长度
+	 * @note
+	 * 数据报格式: <type> seq=<n>,<键值对>
+	 */
+	void Publish(const char* data, int n);
+	/*!
+	 * @brief 查看被丢弃的数据报数量
+	 */
+	uint64_t Failed();
+};
+using McastPtr = StatusMulticast::Pointer;
+
+#endif /* SRC_STATUSMULTICAST_H_ */
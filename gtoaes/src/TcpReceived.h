@@ -4,12 +4,24 @@
  * @version 0.1
  * @date 2020-11-21
  * @author 卢晓猛
+ * @version 0.2
+ * @date 2026-10-17
+ * @note
+ * - 携带在I/O线程中解析完成的协议. 消息队列不再访问连接接收缓冲区
+ * - 以TcpRcvPtr随消息投递(MessagePayload)
+ * - 设备实时状态可合并: 同一设备未处理的状态由后续状态替换. 设备由类型与gid:uid:cid区分
+ * - 降水报警与关闭天窗指令经安全通道投递
  */
 
 #ifndef SRC_TCPRECEIVED_H_
 #define SRC_TCPRECEIVED_H_
 
+#include <string>
+#include <boost/algorithm/string/predicate.hpp>
 #include "AsioTCP.h"
+#include "AstroDeviceDef.h"
+#include "KvProtocol.h"
+#include "NonkvProtocol.h"
 
 /*!
  * @struct TcpReceived
@@ -21,6 +33,9 @@ struct TcpReceived {
 	TcpCPtr client;	///< 网络连接
 	int peer;		///< 主机类型
 	bool hadRcvd;	///< 远程套接口关闭
+	kvbase kv;		///< 解析后的键值对协议
+	nonkvbase nonkv;	///< 解析后的非键值对协议
+	std::string rcvd;	///< 无法解析的原始信息, 用于记录日志
 
 public:
 	TcpReceived(TcpCPtr _client, int _peer, bool _rcvd) {
@@ -32,8 +47,40 @@ public:
 	static Pointer Create(TcpCPtr _client, int _peer, bool _rcvd) {
 		return Pointer(new TcpReceived(_client, _peer, _rcvd));
 	}
+	/*!
+	 * @brief 检查是否设备实时状态: 转台或相机状态
+	 */
+	bool IsStatus() const {
+		if (kv.use_count())
+			return (peer == PEER_MOUNT  && boost::iequals(kv->type, KVTYPE_MOUNT))
+				|| (peer == PEER_CAMERA && boost::iequals(kv->type, KVTYPE_CAMERA));
+		return nonkv.use_count() && peer == PEER_MOUNT && boost::iequals(nonkv->type, NONKVTYPE_MOUNT);
+	}
+	/*!
+	 * @brief 查看实时状态的合并键值: 类型与设备编号
+	 * @note
+	 * P2H模式下一个连接承载多个设备的状态, 不同设备的状态不可合并
+	 */
+	std::string StatusKey() const {
+		if (kv.use_count()) return kv->type + ':' + kv->gid + ':' + kv->uid + ':' + kv->cid;
+		if (nonkv.use_count()) return nonkv->type + ':' + nonkv->gid + ':' + nonkv->uid + ':' + nonkv->cid;
+		return std::string();
+	}
+	/*!
+	 * @brief 检查是否安全相关信息: 降水报警与客户端关闭天窗指令
+	 * @note
+	 * - 安全通道先于普通通道处理, 不保持与同一连接其它信息的顺序.
+	 *   仅关闭动作经安全通道: 打开天窗、降水解除及复位与中止指向仍按顺序处理
+	 * - 降水报警可能先于同一连接已排队的天窗注册处理. 天窗注册时补发关闭指令(GeneralControl::secure_slit)
+	 */
+	bool IsSafety() const {
+		if (kv.use_count())
+			return peer == PEER_CLIENT && boost::iequals(kv->type, KVTYPE_SLIT)
+				&& from_kvbase<kv_proto_slit>(kv)->command == CommandSlit::SLITC_CLOSE;
+		return nonkv.use_count() && peer == PEER_MOUNT_ANNEX && boost::iequals(nonkv->type, NONKVTYPE_RAIN)
+			&& from_nonkvbase<nonkv_proto_rain>(nonkv)->state != 0;
+	}
 };
 using TcpRcvPtr = TcpReceived::Pointer;
-using TcpRcvQue = std::deque<TcpRcvPtr>;
 
 #endif /* SRC_TCPRECEIVED_H_ */
@@ -0,0 +1,107 @@
+/**
+ * @file TimerWheel.cpp
+ * @brief 分层时间轮: 管理大量低精度定时器
+ * @version 0.1
+ * @date 2026-10-16
+ */
+
+#include "TimerWheel.h"
+
+using namespace boost::chrono;
+
+TimerWheel::TimerWheel(int tick) {
+	tick_  = tick > 0 ? tick : 1;
+	now_   = 0;
+	start_ = SteadyClock::now();
+	count_ = 0;
+}
+
+TimerWheel::~TimerWheel() {
+	Clear();
+}
+
+void TimerWheel::Schedule(const TimerPtr timer, int ms) {
+	if (!timer.use_count()) return;
+
+	const uint64_t span = (uint64_t(1) << (TW_SLOT_BITS * TW_LEVELS)) - 1;	// 时间轮范围
+	uint64_t ticks = ms > 0 ? (uint64_t(ms) + tick_ - 1) / tick_ : 1;
+	if (ticks > span) ticks = span;
+
+	MtxLck lck(mtx_);
+	if (timer->IsScheduled()) remove(timer);
+	timer->expire = now_ + ticks;
+	insert(timer);
+}
+
+void TimerWheel::Cancel(const TimerPtr timer) {
+	if (!timer.use_count()) return;
+
+	MtxLck lck(mtx_);
+	if (timer->IsScheduled()) remove(timer);
+}
+
+int TimerWheel::Advance(TimerVec& expired) {
+	expired.clear();
+	uint64_t target = duration_cast<milliseconds>(SteadyClock::now() - start_).count() / tick_;
+
+	MtxLck lck(mtx_);
+	for (; now_ <= target; ++now_) {
+		int index = now_ & TW_SLOT_MASK;
+		// 第0层转完一圈: 逐层下沉上层槽位
+		for (int level = 1; !index && level < TW_LEVELS; ++level)
+			index = cascade(level);
+
+		TimerList& list = slots_[now_ & TW_SLOT_MASK];
+		for (TimerList::iterator it = list.begin(); it != list.end(); ++it) {
+			(*it)->slot = -1;
+			expired.push_back(*it);
+		}
+		count_ -= list.size();
+		list.clear();
+	}
+	return expired.size();
+}
+
+int TimerWheel::Size() {
+	MtxLck lck(mtx_);
+	return count_;
+}
+
+void TimerWheel::Clear() {
+	MtxLck lck(mtx_);
+	for (int i = 0; i < TW_LEVELS * TW_SLOTS; ++i) {
+		for (TimerList::iterator it = slots_[i].begin(); it != slots_[i].end(); ++it)
+			(*it)->slot = -1;
+		slots_[i].clear();
+	}
+	count_ = 0;
+}
+
+void TimerWheel::insert(const TimerPtr& timer) {
+	uint64_t expire = timer->expire;
+	uint64_t delta  = expire > now_ ? expire - now_ : 0;
+	int level;
+
+	for (level = 0; level < TW_LEVELS - 1 && delta >= (uint64_t(1) << (TW_SLOT_BITS * (level + 1))); ++level);
+	int slot = level * TW_SLOTS + ((expire >> (TW_SLOT_BITS * level)) & TW_SLOT_MASK);
+	TimerList& list = slots_[slot];
+	timer->slot = slot;
+	timer->pos  = list.insert(list.end(), timer);
+	++count_;
+}
+
+void TimerWheel::remove(const TimerPtr& timer) {
+	slots_[timer->slot].erase(timer->pos);
+	timer->slot = -1;
+	--count_;
+}
+
+int TimerWheel::cascade(int level) {
+	int index = (now_ >> (TW_SLOT_BITS * level)) & TW_SLOT_MASK;
+	TimerList list;
+	list.swap(slots_[level * TW_SLOTS + index]);
+	count_ -= list.size();
+	for (TimerList::iterator it = list.begin(); it != list.end(); ++it)
+		insert(*it);
+	return index;
+}
@@ -0,0 +1,137 @@
+/**
+ * @file TimerWheel.h
+ * @brief 分层时间轮: 管理大量低精度定时器
+ * @version 0.1
+ * @date 2026-10-16
+ * @note
+ * - 4层, 每层64个槽位. 第0层槽位间隔为1个节拍, 上层槽位间隔依次扩大64倍
+ * - 添加与删除定时器的时间复杂度为O(1). 推进时间时只处理到期槽位, 上层槽位在下层转完一圈时下沉
+ * - 定时器到期后从时间轮中移除, 由调用者处理并决定是否重新加入
+ * - 内部加锁, 可在多个线程中调用
+ */
+
+#ifndef SRC_TIMERWHEEL_H_
+#define SRC_TIMERWHEEL_H_
+
+#include <list>
+#include <vector>
+#include <stdint.h>
+#include <boost/smart_ptr/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/chrono/chrono.hpp>
+
+#define TW_LEVELS		4		///< 时间轮层数
+#define TW_SLOT_BITS	6		///< 每层槽位数量的位数
+#define TW_SLOTS		(1 << TW_SLOT_BITS)	///< 每层槽位数量
+#define TW_SLOT_MASK	(TW_SLOTS - 1)
+
+class TimerWheel {
+public:
+	struct Timer;
+	using TimerPtr = boost::shared_ptr<Timer>;
+	using TimerVec = std::vector<TimerPtr>;	//< 到期定时器集合
+
+protected:
+	using TimerList = std::list<TimerPtr>;	//< 槽位中的定时器
+	using MtxLck = boost::unique_lock<boost::mutex>;
+	using SteadyClock = boost::chrono::steady_clock;
+
+public:
+	/*!
+	 * @struct Timer
+	 * @brief 定时器. 使用者继承此类型以携带数据
+	 */
+	struct Timer {
+		friend class TimerWheel;
+
+	protected:
+		uint64_t expire;	//< 到期节拍
+		int slot;			//< 所在槽位: 层序号*TW_SLOTS+槽位序号. < 0时不在时间轮中
+		TimerList::iterator pos;	//< 在槽位中的位置
+
+	public:
+		Timer() {
+			expire = 0;
+			slot   = -1;
+		}
+		virtual ~Timer() {
+		}
+		/*!
+		 * @brief 检查定时器是否在时间轮中
+		 */
+		bool IsScheduled() const {
+			return slot >= 0;
+		}
+	};
+
+protected:
+	/* 成员变量 */
+	int tick_;			//< 节拍, 量纲: 毫秒
+	uint64_t now_;		//< 下一个待处理的节拍
+	SteadyClock::time_point start_;	//< 第0个节拍对应的时间
+	TimerList slots_[TW_LEVELS * TW_SLOTS];	//< 槽位
+	int count_;			//< 时间轮中定时器数量
+	boost::mutex mtx_;	//< 互斥锁
+
+public:
+	/*!
+	 * @param tick  节拍, 量纲: 毫秒
+	 */
+	TimerWheel(int tick = 100);
+	virtual ~TimerWheel();
+	/*!
+	 * @brief 查看节拍
+	 * @return
+	 * 节拍, 量纲: 毫秒
+	 */
+	int Tick() const {
+		return tick_;
+	}
+	/*!
+	 * @brief 加入或重新加入定时器
+	 * @param timer  定时器
+	 * @param ms     延时, 量纲: 毫秒. 按节拍向上取整, 超出时间轮范围时取最大值
+	 */
+	void Schedule(const TimerPtr timer, int ms);
+	/*!
+	 * @brief 从时间轮中移除定时器
+	 * @param timer  定时器
+	 */
+	void Cancel(const TimerPtr timer);
+	/*!
+	 * @brief 按当前时间推进时间轮, 取出所有到期定时器
+	 * @param expired  到期定时器
+	 * @return
+	 * 到期定时器数量
+	 */
+	int Advance(TimerVec& expired);
+	/*!
+	 * @brief 查看时间轮中定时器数量
+	 */
+	int Size();
+	/*!
+	 * @brief 移除所有定时器
+	 */
+	void Clear();
+
+protected:
+	/*!
+	 * @brief 按到期节拍将定时器放入槽位
+	 * @param timer  定时器
+	 */
+	void insert(const TimerPtr& timer);
+	/*!
+	 * @brief 将定时器从所在槽位移除
+	 * @param timer  定时器
+	 */
+	void remove(const TimerPtr& timer);
+	/*!
+	 * @brief 将上层槽位中的定时器重新放入下层槽位
+	 * @param level  层序号
+	 * @return
+	 * 被处理的槽位序号
+	 */
+	int cascade(int level);
+};
+
+#endif /* SRC_TIMERWHEEL_H_ */
@@ -0,0 +1,1026 @@
+/**
+ * @file bench.cpp
+ * @brief gtoaes微基准: 在进程内测量网络与消息队列组件的吞吐量与时延
+ * @version 0.1
+ * @date 2026-10-17
+ * @note
+ * - 用法: gtoaes-bench <模式> [选项]. 每种模式独立运行, 不需要gtoaes服务器
+ * - accept: 环回地址上的连接风暴, 统计TcpServer每秒接受的连接数
+ * - line: 环回连接上的请求-应答, 比较两种信息处理路径的往返时延与每条信息的内存分配次数:
+ *   read回调 -> 队列 -> 工作线程, 与I/O线程中逐条处理(RegisterLine)
+ * - delegate: 回调函数的单次调用开销: boost::signals2::signal, Delegate, 以及在互斥锁保护下拷贝后调用的Delegate
+ * - mq: 消息队列的吞吐量与投递-响应时延: boost::interprocess::message_queue与MessageQueue(环形队列)
+ * - payload: 消息携带数据的两种方式: 数据存入加锁的队列, 消息只通知; 数据随消息入队(MessagePayload)
+ * - coalesce: 响应慢于投递时, 逐条处理与合并(MessageSlot)状态消息的积压与状态时效,
+ *   并检查合并后状态消息与同一来源其它消息的处理顺序
+ * - uring: 多个环回连接上的逐行回显, 比较io_uring与epoll接收方式的每条信息系统调用次数与每轮时延.
+ *   非io_uring版本(未定义USE_IO_URING)只测量epoll
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <atomic>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <new>
+#include <boost/bind/bind.hpp>
+#include <boost/chrono/chrono.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/signals2/signal.hpp>
+#include <boost/interprocess/ipc/message_queue.hpp>
+#include <boost/smart_ptr/make_shared.hpp>
+#include "AsioTCP.h"
+#include "MessageQueue.h"
+#include "GLog.h"
+
+using namespace std;
+using namespace boost::placeholders;
+
+using SteadyClock = boost::chrono::steady_clock;
+using MtxLck = boost::unique_lock<boost::mutex>;
+
+GLog _gLog(stdout);	///< MessageQueue的工作日志
+
+//////////////////////////////////////////////////////////////////////////////
+/*----------------- 内存分配计数 -----------------*/
+static std::atomic<long> allocs_(0);	///< operator new调用次数
+/* 替换全局operator new/delete. 禁止内联: 调用处可见free()时编译器误报new/delete不匹配 */
+
+__attribute__((noinline)) void* operator new(size_t n) {
+	allocs_.fetch_add(1, std::memory_order_relaxed);
+	void* ptr = malloc(n ? n : 1);
+	if (!ptr) throw std::bad_alloc();
+	return ptr;
+}
+
+__attribute__((noinline)) void* operator new[](size_t n) {
+	allocs_.fetch_add(1, std::memory_order_relaxed);
+	void* ptr = malloc(n ? n : 1);
+	if (!ptr) throw std::bad_alloc();
+	return ptr;
+}
+
+__attribute__((noinline)) void operator delete(void* ptr) noexcept {
+	free(ptr);
+}
+
+__attribute__((noinline)) void operator delete[](void* ptr) noexcept {
+	free(ptr);
+}
+
+__attribute__((noinline)) void operator delete(void* ptr, size_t) noexcept {
+	free(ptr);
+}
+
+__attribute__((noinline)) void operator delete[](void* ptr, size_t) noexcept {
+	free(ptr);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/*----------------- 系统调用计数 -----------------*/
+/* 替换asio使用的接收、发送与等待入口, 经syscall()转发. uring模式的客户端使用read()/write(), 不计入 */
+static std::atomic<uint64_t> sysRecv_(0);	///< recv与recvmsg调用次数
+static std::atomic<uint64_t> sysSend_(0);	///< send与sendmsg调用次数
+static std::atomic<uint64_t> sysWait_(0);	///< epoll_wait调用次数
+
+extern "C" ssize_t recv(int fd, void* buf, size_t n, int flags) {
+	sysRecv_.fetch_add(1, std::memory_order_relaxed);
+	return syscall(SYS_recvfrom, fd, buf, n, flags, NULL, NULL);
+}
+
+extern "C" ssize_t send(int fd, const void* buf, size_t n, int flags) {
+	sysSend_.fetch_add(1, std::memory_order_relaxed);
+	return syscall(SYS_sendto, fd, buf, n, flags, NULL, 0);
+}
+
+extern "C" ssize_t recvmsg(int fd, struct msghdr* msg, int flags) {
+	sysRecv_.fetch_add(1, std::memory_order_relaxed);
+	return syscall(SYS_recvmsg, fd, msg, flags);
+}
+
+extern "C" ssize_t sendmsg(int fd, const struct msghdr* msg, int flags) {
+	sysSend_.fetch_add(1, std::memory_order_relaxed);
+	return syscall(SYS_sendmsg, fd, msg, flags);
+}
+
+extern "C" int epoll_wait(int epfd, struct epoll_event* events, int maxevents, int timeout) {
+	sysWait_.fetch_add(1, std::memory_order_relaxed);
+	return syscall(SYS_epoll_pwait, epfd, events, maxevents, timeout, NULL, 8);
+}
+
+/*!
+ * @brief 自起点经过的时间
+ * @return
+ * 秒数
+ */
+static double elapsed(const SteadyClock::time_point& t0) {
+	return boost::chrono::duration<double>(SteadyClock::now() - t0).count();
+}
+
+/*!
+ * @brief 单调时钟的当前时刻
+ * @return
+ * 纳秒数
+ */
+static long now_ns() {
+	return boost::chrono::duration_cast<boost::chrono::nanoseconds>(SteadyClock::now().time_since_epoch()).count();
+}
+
+/*!
+ * @brief 查看排序后样本的百分位数
+ */
+static double percentile(const vector<double>& v, double p) {
+	return v.empty() ? 0.0 : v[size_t((v.size() - 1) * p)];
+}
+
+/*!
+ * @brief 连接到本机端口
+ * @return
+ * 阻塞模式套接口. < 0时失败
+ */
+static int connect_local(int port) {
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family      = AF_INET;
+	addr.sin_port        = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd >= 0 && connect(fd, (sockaddr*) &addr, sizeof(addr))) {
+		close(fd);
+		fd = -1;
+	}
+	return fd;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/*----------------- accept: 连接风暴 -----------------*/
+static std::atomic<int> accepted_(0);	///< 已接受的连接数量
+
+static void on_accept(const TcpCPtr client, const TcpSPtr server) {
+	++accepted_;
+}
+
+/*!
+ * @brief 每轮以非阻塞connect同时发起n个环回连接, 统计服务器接受全部连接的用时
+ */
+static int bench_accept(int argc, char **argv) {
+	int n(2000), rounds(5), port(4999), threads(1);
+	int ch;
+
+	while ((ch = getopt(argc, argv, "c:r:p:n:")) != -1) {
+		switch (ch) {
+		case 'c': n       = atoi(optarg); break;
+		case 'r': rounds  = atoi(optarg); break;
+		case 'p': port    = atoi(optarg); break;
+		case 'n': threads = atoi(optarg); break;
+		default:  return -1;
+		}
+	}
+
+	AsioIOServicePool::Instance().Start(threads);
+	TcpSPtr server = TcpServer::Create();
+	server->RegisterAccept(boost::bind(&on_accept, _1, _2));
+	if (!server->CreateServer(port)) {
+		printf("failed to listen on port %d\n", port);
+		return 1;
+	}
+
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family      = AF_INET;
+	addr.sin_port        = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	double sum(0.0), best(0.0);
+	for (int r = 0; r < rounds; ++r) {
+		vector<int> fds(n);
+		accepted_ = 0;
+		SteadyClock::time_point t0 = SteadyClock::now();
+		for (int i = 0; i < n; ++i) {
+			fds[i] = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+			connect(fds[i], (sockaddr*) &addr, sizeof(addr));
+		}
+		while (accepted_ < n && elapsed(t0) < 20.0) usleep(50);
+		double dt = elapsed(t0);
+		double rate = accepted_ / dt;
+		printf("round %d: %d accepts in %.3f ms, %.0f/s\n", r, accepted_.load(), dt * 1E3, rate);
+		sum += rate;
+		if (rate > best) best = rate;
+		for (int i = 0; i < n; ++i) close(fds[i]);
+		usleep(200000);	// 等待服务器回收连接
+	}
+	printf("accepts/s mean %.0f, best %.0f; idle pooled clients %d\n",
+			sum / rounds, best, TcpClientPool::Instance()->Size());
+	server->Close();
+	AsioIOServicePool::Instance().Stop();
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/*----------------- line: 信息处理路径 -----------------*/
+/*!
+ * @class LineEcho
+ * @brief 回显服务器. 按选定路径处理每条信息
+ */
+class LineEcho {
+protected:
+	bool online_;	///< true: 在I/O线程中逐条处理; false: 经队列由工作线程处理
+	std::deque<TcpCPtr> queue_;	///< 有数据到达的连接
+	boost::mutex mtx_;
+	boost::condition_variable cv_;
+	boost::thread thrd_;	///< 工作线程
+	NetBuffer::LineVec lines_;
+
+public:
+	LineEcho(bool online) : online_(online) {
+		if (!online_) thrd_ = boost::thread(boost::bind(&LineEcho::work, this));
+	}
+
+	virtual ~LineEcho() {
+		if (thrd_.joinable()) {
+			thrd_.interrupt();
+			thrd_.join();
+		}
+	}
+
+	void Accept(const TcpCPtr client, const TcpSPtr server) {
+		if (online_) client->RegisterLine(boost::bind(&LineEcho::on_line, this, _1, _2, _3));
+		else client->RegisterRead(boost::bind(&LineEcho::on_read, this, _1, _2));
+	}
+
+protected:
+	void on_line(const TcpCPtr client, char* line, int n) {
+		client->Write(line, n);
+		client->Write("\n", 1);
+	}
+
+	void on_read(const TcpCPtr client, const boost::system::error_code& ec) {
+		if (ec) return;
+		MtxLck lck(mtx_);
+		queue_.push_back(client);
+		cv_.notify_one();
+	}
+
+	void work() {
+		while (1) {
+			TcpCPtr client;
+			{
+				MtxLck lck(mtx_);
+				while (queue_.empty()) cv_.wait(lck);
+				client = queue_.front();
+				queue_.pop_front();
+			}
+			client->Cork();
+			client->ExtractLines(lines_);
+			for (NetBuffer::LineVec::iterator it = lines_.begin(); it != lines_.end(); ++it) {
+				client->Write(it->first, it->second);
+				client->Write("\n", 1);
+			}
+			client->ReleaseLines();
+			client->Uncork();
+		}
+	}
+};
+
+/*!
+ * @brief 单连接请求-应答. 每次发送一条转台状态并等待回显
+ */
+static int bench_line(int argc, char **argv) {
+	int n(20000), port(5123);
+	int ch;
+
+	while ((ch = getopt(argc, argv, "m:p:")) != -1) {
+		switch (ch) {
+		case 'm': n    = atoi(optarg); break;
+		case 'p': port = atoi(optarg); break;
+		default:  return -1;
+		}
+	}
+
+	const char msg[] = "mount gid=001,uid=001,state=5,ra=10.0,dec=20.0\n";
+	const int len = sizeof(msg) - 1, warmup = 1000;
+	AsioIOServicePool::Instance().Start(1);
+	for (int online = 0; online < 2; ++online) {
+		LineEcho echo(online);
+		TcpSPtr server = TcpServer::Create();
+		server->RegisterAccept(boost::bind(&LineEcho::Accept, &echo, _1, _2));
+		if (!server->CreateServer(port)) {
+			printf("failed to listen on port %d\n", port);
+			return 1;
+		}
+		int fd = connect_local(port);
+		if (fd < 0) {
+			printf("failed to connect to port %d\n", port);
+			return 1;
+		}
+
+		vector<double> lat;
+		char buff[256];
+		long a0(0);
+		lat.reserve(n);
+		for (int i = 0; i < n + warmup; ++i) {
+			if (i == warmup) a0 = allocs_.load();
+			SteadyClock::time_point t0 = SteadyClock::now();
+			send(fd, msg, len, 0);
+			for (int got = 0, k; got < len; got += k) {
+				if ((k = recv(fd, buff + got, sizeof(buff) - got, 0)) <= 0) {
+					printf("connection closed\n");
+					return 1;
+				}
+			}
+			if (i >= warmup) lat.push_back(elapsed(t0) * 1E6);
+		}
+		long allocs = allocs_.load() - a0;	// 含客户端收发, 两种路径相同
+		std::sort(lat.begin(), lat.end());
+		printf("%-28s p50 %6.1f us  p99 %6.1f us  max %7.1f us  allocations/msg %.2f\n",
+				online ? "RegisterLine on I/O thread" : "read callback + queue",
+				percentile(lat, 0.5), percentile(lat, 0.99), lat.back(), double(allocs) / n);
+		close(fd);
+		server->Close();
+		usleep(100000);
+	}
+	AsioIOServicePool::Instance().Stop();
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/*----------------- delegate: 回调开销 -----------------*/
+/*!
+ * @class ReadSink
+ * @brief 模拟read回调的接收对象. 回调函数与TcpClient::CallbackFunc签名相同, 另绑定主机类型
+ */
+class ReadSink {
+public:
+	long total;
+
+public:
+	ReadSink() : total(0) {}
+
+	void Receive(const TcpCPtr client, const boost::system::error_code& ec, int peer) {
+		total += peer;
+	}
+};
+
+/*!
+ * @brief 以相同的boost::bind对象分别经三种方式调用n次, 统计每次调用的平均用时
+ */
+static int bench_delegate(int argc, char **argv) {
+	using Signal = boost::signals2::signal<void (const TcpCPtr, const boost::system::error_code&)>;
+
+	long n(10000000);
+	int rounds(3);
+	int ch;
+
+	while ((ch = getopt(argc, argv, "e:r:")) != -1) {
+		switch (ch) {
+		case 'e': n      = atol(optarg); break;
+		case 'r': rounds = atoi(optarg); break;
+		default:  return -1;
+		}
+	}
+
+	ReadSink sink;
+	TcpCPtr client;
+	boost::system::error_code ec;
+	Signal sig;
+	sig.connect(boost::bind(&ReadSink::Receive, &sink, _1, _2, 1));
+	TcpClient::CBSlot dlg(boost::bind(&ReadSink::Receive, &sink, _1, _2, 1));
+	boost::mutex mtx;
+
+	for (int r = 0; r < rounds; ++r) {
+		SteadyClock::time_point t0 = SteadyClock::now();
+		for (long i = 0; i < n; ++i) sig(client, ec);
+		double tSig = elapsed(t0);
+		t0 = SteadyClock::now();
+		for (long i = 0; i < n; ++i) dlg(client, ec);
+		double tDlg = elapsed(t0);
+		t0 = SteadyClock::now();
+		for (long i = 0; i < n; ++i) {// 与TcpClient::notify_read()相同: 在锁内拷贝, 锁外调用
+			TcpClient::CBSlot func;
+			{
+				MtxLck lck(mtx);
+				func = dlg;
+			}
+			func(client, ec);
+		}
+		double tCopy = elapsed(t0);
+		printf("signals2 %6.1f ns/event  Delegate %6.1f ns/event  Delegate copied under mutex %6.1f ns/event\n",
+				tSig * 1E9 / n, tDlg * 1E9 / n, tCopy * 1E9 / n);
+	}
+	return sink.total == 3 * rounds * n ? 0 : 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/*----------------- mq: 消息队列 -----------------*/
+/*!
+ * @class MqSink
+ * @brief 消息响应: par1为投递时刻, 记录投递-响应时延. 仅由消息响应线程调用
+ */
+class MqSink {
+public:
+	vector<double> lat;		//< 时延, 微秒
+	std::atomic<long> got;	//< 已响应消息数量
+
+public:
+	MqSink() : got(0) {}
+
+	void Receive(const long t, const long) {
+		lat.push_back((now_ns() - t) * 1E-3);
+		got.fetch_add(1, std::memory_order_release);
+	}
+};
+
+/*!
+ * @class IpcQueue
+ * @brief 基于boost::interprocess::message_queue的消息队列, 与MessageQueue改为环形队列前的实现相同:
+ * 深度1024, 投递优先级1, 单一响应线程
+ */
+class IpcQueue {
+protected:
+	struct Message {
+		long id;			// 消息编号
+		long par1, par2;	// 参数
+	};
+	using MQ = boost::interprocess::message_queue;
+	using MQPtr = boost::shared_ptr<MQ>;
+	using ThreadPtr = boost::shared_ptr<boost::thread>;
+	using CallbackFunc = boost::signals2::signal<void (const long, const long)>;
+
+	string name_;		//< 消息队列名称
+	MQPtr mqptr_;		//< 消息队列
+	ThreadPtr thrd_;	//< 消息响应线程
+	CallbackFunc func_;	//< 回调函数. 与MessageQueue相同, 经signals2分发
+
+public:
+	MqSink sink;
+
+public:
+	bool Start(const char *name) {
+		name_ = name;
+		try {
+			MQ::remove(name);
+			mqptr_.reset(new MQ(boost::interprocess::create_only, name, 1024, sizeof(Message)));
+			func_.connect(boost::bind(&MqSink::Receive, &sink, _1, _2));
+			thrd_.reset(new boost::thread(boost::bind(&IpcQueue::thread_message, this)));
+			return true;
+		}
+		catch(boost::interprocess::interprocess_exception &ex) {
+			printf("failed to create message queue <%s>: %s\n", name, ex.what());
+			return false;
+		}
+	}
+
+	void Stop() {
+		if (thrd_.unique()) {
+			Message msg = { 0, 0, 0 };
+			mqptr_->send(&msg, sizeof(Message), 10);
+			thrd_->join();
+			thrd_.reset();
+			mqptr_.reset();
+			MQ::remove(name_.c_str());
+		}
+	}
+
+	void Post(long t) {
+		Message msg = { 1, t, 0 };
+		mqptr_->send(&msg, sizeof(Message), 1);
+	}
+
+protected:
+	void thread_message() {
+		Message msg;
+		MQ::size_type szrcv;
+		uint32_t priority;
+
+		do {
+			mqptr_->receive(&msg, sizeof(Message), szrcv, priority);
+			if (msg.id) func_(msg.par1, msg.par2);
+		} while (msg.id);
+	}
+};
+
+/*!
+ * @class RingQueue
+ * @brief 当前的MessageQueue
+ */
+class RingQueue : public MessageQueue {
+public:
+	MqSink sink;
+
+public:
+	void Post(long t) {
+		PostMessage(MSG_USER, t);
+	}
+
+protected:
+	void register_messages() {
+		RegisterMessage(MSG_USER, boost::bind(&MqSink::Receive, &sink, _1, _2));
+	}
+};
+
+/*!
+ * @brief 由多个生产者线程各投递n条消息, 或由一个生产者间隔pace微秒投递n条消息, 统计吞吐量与时延
+ */
+template <class Queue>
+static bool run_mq(const char *name, int producers, long n, int pace) {
+	Queue que;
+	if (!que.Start("gtoaes-bench")) return false;
+
+	long total = n * producers;
+	que.sink.lat.reserve(total);
+	SteadyClock::time_point t0 = SteadyClock::now();
+	if (pace) {
+		for (long i = 0; i < n; ++i) {
+			que.Post(now_ns());
+			boost::this_thread::sleep_for(boost::chrono::microseconds(pace));
+		}
+	}
+	else {
+		boost::thread_group thrds;
+		for (int i = 0; i < producers; ++i) {
+			thrds.create_thread([&que, n]() {
+				for (long k = 0; k < n; ++k) que.Post(now_ns());
+			});
+		}
+		thrds.join_all();
+	}
+	while (que.sink.got.load(std::memory_order_acquire) < total)
+		boost::this_thread::sleep_for(boost::chrono::microseconds(100));
+	double secs = elapsed(t0);
+	que.Stop();
+
+	vector<double>& lat = que.sink.lat;
+	sort(lat.begin(), lat.end());
+	char title[40];
+	if (pace) sprintf(title, "paced %dus, 1 producer", pace);
+	else sprintf(title, "burst, %d producer(s)", producers);
+	printf("%-22s %-26s %9.0f msg/s  p50 %8.1f us  p99 %9.1f us  max %9.1f us\n", name, title,
+			total / secs, percentile(lat, 0.5), percentile(lat, 0.99), lat.back());
+	return true;
+}
+
+/*!
+ * @brief 以1个与4个生产者突发投递, 以及单一生产者定时投递, 比较两种消息队列
+ */
+static int bench_mq(int argc, char **argv) {
+	long n(200000), paced(20000);
+	int pace(50);
+	int ch;
+
+	while ((ch = getopt(argc, argv, "n:p:u:")) != -1) {
+		switch (ch) {
+		case 'n': n     = atol(optarg); break;
+		case 'p': paced = atol(optarg); break;
+		case 'u': pace  = atoi(optarg); break;
+		default:  return -1;
+		}
+	}
+	if (n <= 0 || paced <= 0 || pace <= 0) return -1;
+
+	const int producers[] = { 1, 4 };
+	for (int prod : producers) {
+		if (!run_mq<IpcQueue>("interprocess", prod, n, 0)
+				|| !run_mq<RingQueue>("MessageQueue", prod, n, 0))
+			return 1;
+	}
+	if (!run_mq<IpcQueue>("interprocess", 1, paced, pace)
+			|| !run_mq<RingQueue>("MessageQueue", 1, paced, pace))
+		return 1;
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/*----------------- payload: 消息携带数据 -----------------*/
+/*!
+ * @struct BenchEvent
+ * @brief 随消息传递的数据, 与TcpRcvPtr等相同以共享指针传递
+ */
+struct BenchEvent {
+	long t;		//< 投递时刻
+	long seq;	//< 序号
+};
+using EventPtr = boost::shared_ptr<BenchEvent>;
+
+/*!
+ * @class SideQueue
+ * @brief 数据存入加锁的队列, 消息只作通知. 与GeneralControl::que_tcpRcv_等改为MessagePayload前的方式相同
+ */
+class SideQueue : public MessageQueue {
+protected:
+	std::deque<EventPtr> que_;	//< 数据队列
+	boost::mutex mtx_;			//< 互斥锁: 数据队列
+
+public:
+	MqSink sink;
+
+public:
+	void Post(long t) {
+		EventPtr event = boost::make_shared<BenchEvent>();
+		event->t = t;
+		{
+			MtxLck lck(mtx_);
+			que_.push_back(event);
+		}
+		PostMessage(MSG_USER);
+	}
+
+protected:
+	void register_messages() {
+		RegisterMessage(MSG_USER, boost::bind(&SideQueue::on_event, this, _1, _2));
+	}
+
+	void on_event(const long, const long) {
+		EventPtr event;
+		{
+			MtxLck lck(mtx_);
+			event = que_.front();
+			que_.pop_front();
+		}
+		sink.Receive(event->t, 0);
+	}
+};
+
+/*!
+ * @class InlineQueue
+ * @brief 数据随消息入队
+ */
+class InlineQueue : public MessageQueue {
+public:
+	MqSink sink;
+
+public:
+	void Post(long t) {
+		EventPtr event = boost::make_shared<BenchEvent>();
+		event->t = t;
+		PostMessage(MSG_USER, MessagePayload(std::move(event)));
+	}
+
+protected:
+	void register_messages() {
+		RegisterPayload(MSG_USER, boost::bind(&InlineQueue::on_event, this, _1, _2, _3));
+	}
+
+	void on_event(const long, const long, MessagePayload& payload) {
+		EventPtr event = payload.Take<EventPtr>();
+		sink.Receive(event->t, 0);
+	}
+};
+
+/*!
+ * @brief 以1个与4个生产者突发投递共享指针数据, 比较两种携带方式
+ */
+static int bench_payload(int argc, char **argv) {
+	long n(200000);
+	int ch;
+
+	while ((ch = getopt(argc, argv, "n:")) != -1) {
+		switch (ch) {
+		case 'n': n = atol(optarg); break;
+		default:  return -1;
+		}
+	}
+	if (n <= 0) return -1;
+
+	const int producers[] = { 1, 4 };
+	for (int prod : producers) {
+		if (!run_mq<SideQueue>("side deque + mutex", prod, n, 0)
+				|| !run_mq<InlineQueue>("inline payload", prod, n, 0))
+			return 1;
+	}
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/*----------------- coalesce: 合并状态消息 -----------------*/
+/*!
+ * @brief 忙等待, 模拟处理耗时或投递间隔
+ */
+static void spin_us(long us) {
+	long t0 = now_ns();
+	while (now_ns() - t0 < us * 1000);
+}
+
+/*!
+ * @class StatusQueue
+ * @brief 模拟一个网络连接的状态消息与其它消息. 其它消息投递前封闭暂存单元, 与parse_from_peer()相同
+ */
+class StatusQueue : public MessageQueue {
+protected:
+	enum {
+		MSG_STATUS = MSG_USER,	///< 状态消息, par1: 序号
+		MSG_OTHER				///< 其它消息, par1: 投递前最后一条状态的序号
+	};
+
+	bool coalesce_;		//< 是否合并状态消息
+	SlotPtr slot_;		//< 暂存单元
+	long work_;			//< 状态消息处理耗时, 微秒
+
+public:
+	vector<double> age;			//< 状态时效: 投递至处理的时间, 微秒
+	std::atomic<long> last;		//< 最后处理的状态序号
+	long handled;				//< 已处理的状态消息数量
+	long others;				//< 已处理的其它消息数量
+	long misordered;			//< 顺序错误的消息数量
+
+public:
+	StatusQueue(bool coalesce, long work)
+		: coalesce_(coalesce), slot_(MessageSlot::Create()), work_(work)
+		, last(-1), handled(0), others(0), misordered(0) {
+	}
+
+	void PostStatus(long seq) {
+		EventPtr event = boost::make_shared<BenchEvent>();
+		event->t   = now_ns();
+		event->seq = seq;
+		if (coalesce_) PostMessage(MSG_STATUS, slot_, MessagePayload(std::move(event)));
+		else PostMessage(MSG_STATUS, MessagePayload(std::move(event)));
+	}
+
+	void PostOther(long seq) {
+		slot_->Seal();
+		PostMessage(MSG_OTHER, seq);
+	}
+
+protected:
+	void register_messages() {
+		RegisterPayload(MSG_STATUS, boost::bind(&StatusQueue::on_status, this, _1, _2, _3));
+		RegisterMessage(MSG_OTHER,  boost::bind(&StatusQueue::on_other,  this, _1, _2));
+	}
+
+	void on_status(const long, const long, MessagePayload& payload) {
+		EventPtr event = payload.Take<EventPtr>();
+		age.push_back((now_ns() - event->t) * 1E-3);
+		++handled;
+		if (event->seq <= last) ++misordered;
+		spin_us(work_);
+		last.store(event->seq, std::memory_order_release);
+	}
+
+	/*!
+	 * @note 投递前的最后一条状态须已处理, 之后的状态须未处理
+	 */
+	void on_other(const long seq, const long) {
+		++others;
+		if (last.load() != seq) ++misordered;
+	}
+};
+
+/*!
+ * @brief 生产者以固定间隔投递n条状态, 每k条状态后投递一条其它消息; 响应函数处理一条状态耗时work微秒
+ */
+static int bench_coalesce(int argc, char **argv) {
+	long n(20000), interval(10), work(50), k(100);
+	int ch;
+
+	while ((ch = getopt(argc, argv, "n:i:w:k:")) != -1) {
+		switch (ch) {
+		case 'n': n        = atol(optarg); break;
+		case 'i': interval = atol(optarg); break;
+		case 'w': work     = atol(optarg); break;
+		case 'k': k        = atol(optarg); break;
+		default:  return -1;
+		}
+	}
+	if (n <= 0 || interval < 0 || work < 0 || k <= 0) return -1;
+
+	int rslt(0);
+	for (int coalesce = 0; coalesce < 2; ++coalesce) {
+		StatusQueue que(coalesce, work);
+		if (!que.Start("gtoaes-bench")) return 1;
+		que.age.reserve(n);
+
+		SteadyClock::time_point t0 = SteadyClock::now();
+		for (long i = 0; i < n; ++i) {
+			que.PostStatus(i);
+			if ((i + 1) % k == 0) que.PostOther(i);
+			spin_us(interval);
+		}
+		while (que.last.load(std::memory_order_acquire) < n - 1)
+			boost::this_thread::sleep_for(boost::chrono::microseconds(100));
+		double secs = elapsed(t0);
+		que.Stop();
+
+		vector<double>& age = que.age;
+		sort(age.begin(), age.end());
+		printf("%-10s handled %6ld/%ld  coalesced %6llu  drain %.3f s  state age p50 %9.1f us  p99 %9.1f us"
+				"  others %ld/%ld  misordered %ld\n",
+				coalesce ? "coalesced" : "plain", que.handled, n, (unsigned long long) que.CoalescedCount(),
+				secs, percentile(age, 0.5), percentile(age, 0.99), que.others, n / k, que.misordered);
+		if (que.misordered || que.others != n / k) rslt = 1;
+	}
+	return rslt;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+/*----------------- uring: io_uring与epoll接收 -----------------*/
+/*!
+ * @struct SyscallCount
+ * @brief 服务端I/O线程的系统调用计数
+ */
+struct SyscallCount {
+	uint64_t recv;		//< recvmsg
+	uint64_t send;		//< sendmsg
+	uint64_t wait;		//< epoll_wait
+	uint64_t wakeup;	//< 读eventfd: io_uring完成通知
+	uint64_t enter;		//< io_uring_enter
+
+public:
+	SyscallCount() {
+		recv = send = wait = wakeup = enter = 0;
+	}
+	/*!
+	 * @brief 读取当前计数
+	 */
+	void Sample() {
+		recv = sysRecv_.load();
+		send = sysSend_.load();
+		wait = sysWait_.load();
+		wakeup = enter = 0;
+#ifdef USE_IO_URING
+		AsioIOServicePool& pool = AsioIOServicePool::Instance();
+		for (int i = 0; i < pool.Size(); ++i) {
+			uint64_t enters, wakeups, cqes;
+			boost::asio::use_service<IoUringService>(pool.GetIOService(i)).GetStat(enters, wakeups, cqes);
+			wakeup += wakeups;
+			enter  += enters;
+		}
+#endif
+	}
+
+	uint64_t Total() const {
+		return recv + send + wait + wakeup + enter;
+	}
+};
+
+/*!
+ * @brief 在c个连接上进行r轮回显: 每轮每个连接发送一条转台状态, 再依次读出所有回显
+ * @return
+ * 0: 正常; 1: 连接失败
+ */
+static int run_uring(const char* name, int c, int r, int port) {
+	const char msg[] = "mount gid=001,uid=001,state=5,ra=10.0,dec=20.0\n";
+	const int len = sizeof(msg) - 1, warmup = 5;
+	LineEcho echo(true);
+	TcpSPtr server = TcpServer::Create();
+	server->RegisterAccept(boost::bind(&LineEcho::Accept, &echo, _1, _2));
+	if (!server->CreateServer(port)) {
+		printf("failed to listen on port %d\n", port);
+		return 1;
+	}
+
+	vector<int> fds;
+	for (int i = 0; i < c; ++i) {
+		int fd = connect_local(port);
+		if (fd < 0) {
+			printf("failed to connect to port %d\n", port);
+			for (size_t j = 0; j < fds.size(); ++j) close(fds[j]);
+			return 1;
+		}
+		fds.push_back(fd);
+	}
+
+	vector<double> lat;
+	SyscallCount s0, s1;
+	char buff[256];
+	int rslt(0);
+	lat.reserve(r);
+	for (int i = 0; i < r + warmup && !rslt; ++i) {
+		if (i == warmup) s0.Sample();
+		SteadyClock::time_point t0 = SteadyClock::now();
+		for (int j = 0; j < c && !rslt; ++j) {
+			if (write(fds[j], msg, len) != len) {
+				printf("connection closed\n");
+				rslt = 1;
+			}
+		}
+		for (int j = 0; j < c && !rslt; ++j) {
+			for (int got = 0, k; got < len; got += k) {
+				if ((k = read(fds[j], buff + got, sizeof(buff) - got)) <= 0) {
+					printf("connection closed\n");
+					rslt = 1;
+					break;
+				}
+			}
+		}
+		if (i >= warmup) lat.push_back(elapsed(t0) * 1E6);
+	}
+	s1.Sample();
+	for (int j = 0; j < c; ++j) close(fds[j]);
+	server->Close();
+	usleep(200000);
+	if (rslt) return rslt;
+
+	double msgs = double(c) * r;
+	std::sort(lat.begin(), lat.end());
+	printf("%-8s recv %7llu  send %7llu  epoll_wait %6llu  eventfd %6llu  io_uring_enter %6llu  %.2f syscalls/msg"
+			"  round p50 %7.1f us  p99 %7.1f us\n", name,
+			(unsigned long long) (s1.recv - s0.recv), (unsigned long long) (s1.send - s0.send),
+			(unsigned long long) (s1.wait - s0.wait), (unsigned long long) (s1.wakeup - s0.wakeup),
+			(unsigned long long) (s1.enter - s0.enter), (s1.Total() - s0.Total()) / msgs,
+			percentile(lat, 0.5), percentile(lat, 0.99));
+	return 0;
+}
+
+/*!
+ * @brief 服务端在一个I/O线程中以RegisterLine()回显. 先测量io_uring接收, 再停用io_uring测量epoll接收
+ */
+static int bench_uring(int argc, char **argv) {
+	int c(256), r(200), port(5123);
+	int ch;
+
+	while ((ch = getopt(argc, argv, "c:r:p:")) != -1) {
+		switch (ch) {
+		case 'c': c    = atoi(optarg); break;
+		case 'r': r    = atoi(optarg); break;
+		case 'p': port = atoi(optarg); break;
+		default:  return -1;
+		}
+	}
+	if (c <= 0 || r <= 0) return -1;
+
+	AsioIOServicePool& pool = AsioIOServicePool::Instance();
+	int rslt(0);
+	pool.Start(1);
+#ifdef USE_IO_URING
+	IoUringService& uring = boost::asio::use_service<IoUringService>(pool.GetIOService(0));
+	if (uring.IsValid()) rslt = run_uring("io_uring", c, r, port);
+	else printf("io_uring is not available, measuring epoll only\n");
+	uring.Disable();
+#else
+	printf("built without io_uring (configure --enable-io-uring), measuring epoll only\n");
+#endif
+	if (!rslt) rslt = run_uring("epoll", c, r, port);
+	pool.Stop();
+	return rslt;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+struct BenchMode {
+	const char* name;	///< 模式名称
+	int (*func)(int, char**);	///< 执行函数. 选项错误时返回-1
+	const char* usage;	///< 选项说明
+};
+
+static const BenchMode modes[] = {
+	{"accept", bench_accept,
+		"accept  [-c conns] [-r rounds] [-p port] [-n threads]\n"
+		"        loopback connect storm against TcpServer, default 2000 conns x 5 rounds on port 4999, 1 I/O thread"},
+	{"line", bench_line,
+		"line    [-m msgs] [-p port]\n"
+		"        ping-pong latency and allocations per line: read callback + queue + worker vs RegisterLine,\n"
+		"        default 20000 lines on port 5123"},
+	{"delegate", bench_delegate,
+		"delegate [-e events] [-r rounds]\n"
+		"        cost per read callback: signals2 vs Delegate vs Delegate copied under a mutex, default 10M events x 3"},
+	{"mq", bench_mq,
+		"mq [-n messages per producer] [-p paced messages] [-u pace, us]\n"
+		"        throughput and post-to-handler latency: interprocess::message_queue vs MessageQueue,\n"
+		"        default 200000 messages from 1 and 4 producers, then 20000 messages every 50us"},
+	{"payload", bench_payload,
+		"payload [-n messages per producer]\n"
+		"        shared_ptr data parked in a locked deque vs moved inline with the message,\n"
+		"        default 200000 messages from 1 and 4 producers"},
+	{"coalesce", bench_coalesce,
+		"coalesce [-n statuses] [-i post interval, us] [-w handler time, us] [-k statuses per other message]\n"
+		"        backlog and state age with a slow handler, plain vs coalesced status messages,\n"
+		"        plus ordering against sealed messages from the same source; default 20000, 10us, 50us, 100"},
+	{"uring", bench_uring,
+		"uring [-c connections] [-r rounds] [-p port]\n"
+		"        one-line echo on many loopback connections: syscalls per message and round latency,\n"
+		"        io_uring vs epoll receive (epoll only without --enable-io-uring), default 256 x 200 on port 5123"},
+};
+
+static void usage() {
+	printf("Usage: gtoaes-bench <mode> [options]\n");
+	for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); ++i)
+		printf("  %s\n", modes[i].usage);
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		usage();
+		return 1;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+	for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); ++i) {
+		if (!strcmp(argv[1], modes[i].name)) {// 选项从模式名称之后开始
+			int rslt = modes[i].func(argc - 1, argv + 1);
+			if (rslt < 0) usage();
+			return rslt < 0 ? 1 : rslt;
+		}
+	}
+	usage();
+	return 1;
+}
@@ -64,6 +64,15 @@ GLog _gLog(stdout);
 GLog _gLog(gLogDir, gLogPrefix);		/// 工作日志
 #endif
 
+/*!
+ * @brief 收到SIGUSR1时输出网络连接收发统计, 并继续等待信号
+ */
+void ReportNetwork(boost::asio::signal_set* signals, GeneralControl* gc, const boost::system::error_code& ec) {
+	if (ec) return;
+	gc->ReportNetwork();
+	signals->async_wait(boost::bind(&ReportNetwork, signals, gc, boost::asio::placeholders::error));
+}
+
 int main(int argc, char **argv) {
 	if (argc >= 2) {// 处理命令行参数
 		if (strcmp(argv[1], "-d") == 0) {
@@ -87,6 +96,8 @@ int main(int argc, char **argv) {
 		// 主程序入口
 		GeneralControl gc;
 		if (gc.Start()) {
+			boost::asio::signal_set sigstat(ios, SIGUSR1);
+			sigstat.async_wait(boost::bind(&ReportNetwork, &sigstat, &gc, boost::asio::placeholders::error));
 			_gLog.Write("Daemon goes running");
 			ios.run();
 			gc.Stop();
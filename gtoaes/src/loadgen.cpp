@@ -0,0 +1,635 @@
+/**
+ * @file loadgen.cpp
+ * @brief gtoaes负载生成器: 模拟大量转台、相机、附属设备与客户端连接本机服务器, 统计吞吐量、时延与服务器端错误
+ * @version 0.1
+ * @date 2026-10-17
+ * @note
+ * - 每类连接的数量与发送频率由命令行参数设定, 端口为基准端口+主机类型(PEER_CLIENT~PEER_CAMERA_ANNEX)
+ * - 转台按键值对或非键值对格式发送状态, 相机发送状态, 转台附属设备发送天窗状态, 相机附属设备发送文件描述信息
+ * - 客户端以check_plan查询计划状态, 由应答计算往返时延; 可周期性成组发送append_plan
+ * - 查询的计划编号以Q引导, 追加的计划编号以L引导, 以区分查询应答与观测系统推送的计划状态
+ * - 服务器端错误: 连接失败、服务器关闭连接、发送队列溢出
+ * - 转台先连接并发送状态以创建观测系统, 其它设备与客户端延迟1秒后开始发送
+ * - 可选: 模拟气象站, 以非键值对格式注册为组内天窗, 周期性发送降水报警与解除,
+ *   统计从发送报警至收到关闭天窗指令的时延. 追加计划时, 报警紧随一组计划发送.
+ *   服务器需启用该组的天窗与雨量
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <signal.h>
+#include <atomic>
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
+#include <boost/bind/bind.hpp>
+#include <boost/chrono/chrono.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/smart_ptr/make_shared.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "AsioTCP.h"
+#include "AstroDeviceDef.h"
+#include "KvProtocol.h"
+#include "NonkvProtocol.h"
+
+using namespace std;
+using namespace boost::placeholders;
+using namespace boost::posix_time;
+using ErrorCode = boost::system::error_code;
+
+using SteadyClock = boost::chrono::steady_clock;
+using MtxLck = boost::unique_lock<boost::mutex>;
+
+/*!
+ * @brief 发送信息类别
+ */
+enum {
+	LOAD_REGISTER,		///< 客户端注册
+	LOAD_MOUNT,			///< 转台状态, 键值对格式
+	LOAD_NONKV,			///< 转台状态, 非键值对格式
+	LOAD_CAMERA,		///< 相机状态
+	LOAD_SLIT,			///< 天窗状态
+	LOAD_FILEINFO,		///< 文件描述信息
+	LOAD_CHECKPLAN,		///< 查询计划状态
+	LOAD_APPENDPLAN,	///< 追加计划
+	LOAD_RAIN,			///< 降水报警与解除, 非键值对格式
+	LOAD_LAST
+};
+
+static const char* load_desc[] = {
+	"register",
+	"mount",
+	"mount(nonkv)",
+	"camera",
+	"slit",
+	"fileinfo",
+	"check_plan",
+	"append_plan",
+	"rain"
+};
+
+/*!
+ * @struct LoadOption
+ * @brief 命令行参数
+ */
+struct LoadOption {
+	string host;		///< 服务器地址
+	int port;			///< 基准端口, 即客户端端口
+	string gid;			///< 组标志
+	int mounts;			///< 键值对格式转台数量
+	int nonkv;			///< 非键值对格式转台数量
+	int cameras;		///< 相机数量
+	int mountAnnex;		///< 转台附属设备数量
+	int cameraAnnex;	///< 相机附属设备数量
+	int clients;		///< 客户端数量
+	double rateStatus;	///< 设备状态发送频率, 量纲: Hz
+	double rateClient;	///< 客户端查询频率, 量纲: Hz
+	int burst;			///< 每组追加计划数量. 0: 不追加计划
+	int burstPeriod;	///< 追加计划周期, 量纲: 秒
+	int duration;		///< 运行时长, 量纲: 秒
+	int ioThreads;		///< 网络I/O线程数量
+	int rainPeriod;		///< 降水报警周期, 量纲: 秒. 报警后半个周期解除. 0: 不模拟气象站
+
+public:
+	LoadOption() {
+		host        = "127.0.0.1";
+		port        = 4010;
+		gid         = "001";
+		mounts      = 10;
+		nonkv       = 0;
+		cameras     = 0;
+		mountAnnex  = 0;
+		cameraAnnex = 0;
+		clients     = 10;
+		rateStatus  = 1.0;
+		rateClient  = 1.0;
+		burst       = 0;
+		burstPeriod = 10;
+		duration    = 30;
+		ioThreads   = 1;
+		rainPeriod  = 0;
+	}
+};
+
+/*!
+ * @class LoadGenerator
+ * @brief 建立连接, 按设定频率发送信息并统计结果
+ */
+class LoadGenerator {
+protected:
+	/*!
+	 * @struct Peer
+	 * @brief 一条模拟连接
+	 */
+	struct Peer {
+		TcpCPtr client;		//< 网络连接
+		int peer;			//< 主机类型
+		bool nonkv;			//< 使用非键值对格式
+		string gid, uid, cid;	//< 设备标志
+		std::atomic<bool> online;	//< 连接已建立且未断开
+		SteadyClock::time_point next;	//< 下次发送状态或查询的时间
+		SteadyClock::time_point nextBurst;	//< 下次追加计划的时间
+		int seq;			//< 发送序号
+		bool registered;	//< 客户端已注册
+		int rain;			//< 气象站: 最近发送的降水标志. -1: 未发送
+		boost::mutex mtx;	//< 互斥锁: 待应答请求
+		std::deque<SteadyClock::time_point> pending;	//< 待应答请求的发送时间. 气象站: 待关闭天窗的报警发送时间
+
+	public:
+		Peer() : peer(PEER_CLIENT), nonkv(false), online(false), seq(0), registered(false), rain(-1) {
+		}
+		/*!
+		 * @brief 模拟气象站: 非键值对格式的转台附属设备
+		 */
+		bool IsWeather() const {
+			return peer == PEER_MOUNT_ANNEX && nonkv;
+		}
+	};
+	using PeerPtr = boost::shared_ptr<Peer>;
+	using PeerVec = std::vector<PeerPtr>;
+	using LatVec  = std::vector<uint32_t>;	//< 时延, 量纲: 微秒
+
+protected:
+	/* 成员变量 */
+	LoadOption opt_;
+	KvProtoPtr kvProto_;		//< 键值对格式协议, 只在发送线程中使用
+	NonkvProtoPtr nonkvProto_;	//< 非键值对格式协议, 只在发送线程中使用
+	PeerVec peers_;
+	volatile bool running_;		//< 发送线程工作标志
+
+	/* 统计 */
+	std::atomic<uint64_t> msgSent_[LOAD_LAST];	//< 按类别累计发送信息数量
+	std::atomic<uint64_t> bytesSent_;	//< 累计发送字节数
+	std::atomic<uint64_t> dropped_;		//< 发送队列已满而丢弃的信息数量
+	std::atomic<uint64_t> replies_;		//< 客户端收到的查询应答数量
+	std::atomic<uint64_t> pushed_;		//< 客户端收到的其它信息数量
+	std::atomic<uint64_t> bytesRecv_;	//< 累计接收字节数
+	std::atomic<int> connected_;		//< 已建立的连接数量
+	std::atomic<int> connFail_;			//< 连接失败数量
+	std::atomic<int> closedByServer_;	//< 被服务器关闭的连接数量
+	boost::mutex mtx_lat_;	//< 互斥锁: 时延
+	LatVec latWindow_;		//< 当前统计周期内的时延
+	LatVec latTotal_;		//< 全部时延
+	LatVec latAlarm_;		//< 降水报警至关闭天窗指令的时延
+
+public:
+	LoadGenerator(const LoadOption& opt) : opt_(opt) {
+		kvProto_    = KvProtocol::Create();
+		nonkvProto_ = NonkvProtocol::Create();
+		running_    = false;
+		for (int i = 0; i < LOAD_LAST; ++i) msgSent_[i] = 0;
+		bytesSent_ = dropped_ = replies_ = pushed_ = bytesRecv_ = 0;
+		connected_ = connFail_ = closedByServer_ = 0;
+	}
+
+	/*!
+	 * @brief 建立全部连接, 运行设定时长后输出统计结果
+	 */
+	void Run() {
+		SteadyClock::time_point now = SteadyClock::now();
+		create_peers(now);
+		printf("%d connection(s) to %s, base port %d\n", int(peers_.size()), opt_.host.c_str(), opt_.port);
+
+		running_ = true;
+		boost::thread thrd(boost::bind(&LoadGenerator::thread_send, this));
+		report_progress(now);
+		running_ = false;
+		thrd.join();
+		for (PeerVec::iterator it = peers_.begin(); it != peers_.end(); ++it) {
+			(*it)->online = false;
+			(*it)->client->Close();
+		}
+		report_summary(SteadyClock::now() - now);
+	}
+
+protected:
+	static string index_string(int i) {
+		char buff[20];
+		sprintf(buff, "%03d", i);
+		return buff;
+	}
+
+	/*!
+	 * @brief 按参数创建连接. 转台之外的连接延迟1秒开始发送
+	 */
+	void create_peers(SteadyClock::time_point now) {
+		int n = max(opt_.mounts + opt_.nonkv, 1), i;
+		SteadyClock::duration delay = boost::chrono::seconds(1);
+
+		for (i = 0; i < opt_.mounts; ++i)      add_peer(PEER_MOUNT, false, i, 0, now);
+		for (i = 0; i < opt_.nonkv; ++i)       add_peer(PEER_MOUNT, true, opt_.mounts + i, 0, now);
+		for (i = 0; i < opt_.mountAnnex; ++i)  add_peer(PEER_MOUNT_ANNEX, false, i % n, 0, now + delay);
+		for (i = 0; i < opt_.cameras; ++i)     add_peer(PEER_CAMERA, false, i % n, i / n, now + delay);
+		for (i = 0; i < opt_.cameraAnnex; ++i) add_peer(PEER_CAMERA_ANNEX, false, i % n, i / n, now + delay);
+		for (i = 0; i < opt_.clients; ++i)     add_peer(PEER_CLIENT, false, i % n, 0, now + delay);
+		if (opt_.rainPeriod > 0) {// 气象站只有组标志
+			add_peer(PEER_MOUNT_ANNEX, true, 0, 0, now + delay)->uid.clear();
+			peers_.back()->next = now + delay;
+		}
+	}
+
+	PeerPtr add_peer(int type, bool nonkv, int unit, int camera, SteadyClock::time_point start) {
+		PeerPtr peer = boost::make_shared<Peer>();
+		peer->peer  = type;
+		peer->nonkv = nonkv;
+		peer->gid   = opt_.gid;
+		peer->uid   = index_string(unit + 1);
+		peer->cid   = index_string(camera + 1);
+		// 在一个周期内错开各连接的发送时间
+		double rate = type == PEER_CLIENT ? opt_.rateClient : opt_.rateStatus;
+		int64_t period = rate > 0.0 ? int64_t(1E6 / rate) : 1000000;
+		peer->next      = start + boost::chrono::microseconds(rand() % period);
+		peer->nextBurst = start + boost::chrono::microseconds(rand() % 1000000);
+
+		peer->client = TcpClient::Create();
+		const TcpClient::CBSlot& slotConn = boost::bind(&LoadGenerator::handle_connect, this, _1, _2, peer);
+		const TcpClient::CBSlot& slotRead = boost::bind(&LoadGenerator::handle_close, this, _1, _2, peer);
+		const TcpClient::LineFunc& slotLine = boost::bind(&LoadGenerator::handle_line, this, _1, _2, _3, peer);
+		peer->client->RegisterConnect(slotConn);
+		peer->client->RegisterRead(slotRead);
+		peer->client->RegisterLine(slotLine);
+		if (!peer->client->Connect(opt_.host, opt_.port + type)) ++connFail_;
+		peers_.push_back(peer);
+		return peer;
+	}
+
+	void handle_connect(const TcpCPtr client, const ErrorCode& ec, PeerPtr peer) {
+		if (ec) ++connFail_;
+		else {
+			++connected_;
+			peer->online = true;
+		}
+	}
+
+	/*!
+	 * @brief 注册逐条处理函数后, 读回调函数只在连接断开或出错时被调用
+	 */
+	void handle_close(const TcpCPtr client, const ErrorCode& ec, PeerPtr peer) {
+		if (peer->online.exchange(false)) {
+			--connected_;
+			if (running_) ++closedByServer_;
+		}
+	}
+
+	void handle_line(const TcpCPtr client, char* line, int n, PeerPtr peer) {
+		bytesRecv_ += n + 1;
+		if (peer->IsWeather()) {
+			handle_slit_command(line, peer);
+			return;
+		}
+		if (peer->peer != PEER_CLIENT) return;
+		if (strncmp(line, KVTYPE_PLAN " ", sizeof(KVTYPE_PLAN)) || !strstr(line, "plan_sn=Q")) {// 观测系统推送的状态
+			++pushed_;
+			return;
+		}
+
+		SteadyClock::time_point sent;
+		{
+			MtxLck lck(peer->mtx);
+			if (peer->pending.empty()) return;
+			sent = peer->pending.front();
+			peer->pending.pop_front();
+		}
+		uint32_t us = uint32_t(boost::chrono::duration_cast<boost::chrono::microseconds>(SteadyClock::now() - sent).count());
+		++replies_;
+		MtxLck lck(mtx_lat_);
+		latWindow_.push_back(us);
+		latTotal_.push_back(us);
+	}
+
+	/*!
+	 * @brief 气象站收到关闭天窗指令时, 计算与最早未响应报警的时延
+	 */
+	void handle_slit_command(const char* line, PeerPtr peer) {
+		const char* ptr = strstr(line, NONKVTYPE_SLIT);
+		if (!ptr || !isdigit(ptr[sizeof(NONKVTYPE_SLIT) - 1])
+				|| atoi(ptr + sizeof(NONKVTYPE_SLIT) - 1) != CommandSlit::SLITC_CLOSE) {
+			++pushed_;
+			return;
+		}
+
+		SteadyClock::time_point sent;
+		{
+			MtxLck lck(peer->mtx);
+			if (peer->pending.empty()) return;
+			sent = peer->pending.front();
+			peer->pending.pop_front();
+		}
+		uint32_t us = uint32_t(boost::chrono::duration_cast<boost::chrono::microseconds>(SteadyClock::now() - sent).count());
+		MtxLck lck(mtx_lat_);
+		latAlarm_.push_back(us);
+	}
+
+	/*!
+	 * @brief 发送线程: 每10毫秒检查各连接是否到达发送时间
+	 */
+	void thread_send() {
+		boost::chrono::microseconds periodStatus(opt_.rateStatus > 0.0 ? int64_t(1E6 / opt_.rateStatus) : 0);
+		boost::chrono::microseconds periodClient(opt_.rateClient > 0.0 ? int64_t(1E6 / opt_.rateClient) : 0);
+		boost::chrono::seconds periodBurst(opt_.burstPeriod);
+		boost::chrono::milliseconds periodRain(opt_.rainPeriod * 500);
+
+		while (running_) {
+			SteadyClock::time_point now = SteadyClock::now();
+			bool burst(false);	// 本轮已追加计划
+			for (PeerVec::iterator it = peers_.begin(); it != peers_.end(); ++it) {
+				Peer* peer = it->get();
+				if (!peer->online) continue;
+				if (peer->IsWeather()) {// 首次注册天窗并解除降水, 之后交替报警与解除
+					if (now >= peer->next && (peer->rain != 0 || opt_.burst <= 0 || burst)) {
+						if (peer->rain < 0) send(peer, LOAD_SLIT);
+						send(peer, LOAD_RAIN);
+						peer->next += periodRain;
+					}
+				}
+				else if (peer->peer == PEER_CLIENT) {
+					if (!peer->registered && now >= min(peer->next, peer->nextBurst)) {
+						send(peer, LOAD_REGISTER);
+						peer->registered = true;
+					}
+					if (periodClient.count() && now >= peer->next) {
+						send(peer, LOAD_CHECKPLAN);
+						peer->next += periodClient;
+					}
+					if (opt_.burst > 0 && now >= peer->nextBurst) {
+						peer->client->Cork();
+						for (int i = 0; i < opt_.burst; ++i) send(peer, LOAD_APPENDPLAN);
+						peer->client->Uncork();
+						peer->nextBurst += periodBurst;
+						burst = true;
+					}
+				}
+				else if (periodStatus.count() && now >= peer->next) {
+					if      (peer->peer == PEER_MOUNT)        send(peer, peer->nonkv ? LOAD_NONKV : LOAD_MOUNT);
+					else if (peer->peer == PEER_CAMERA)       send(peer, LOAD_CAMERA);
+					else if (peer->peer == PEER_MOUNT_ANNEX)  send(peer, LOAD_SLIT);
+					else if (peer->peer == PEER_CAMERA_ANNEX) send(peer, LOAD_FILEINFO);
+					peer->next += periodStatus;
+				}
+				// 发送线程落后时不补发
+				if (peer->next < now) peer->next = now;
+			}
+			boost::this_thread::sleep_for(boost::chrono::milliseconds(10));
+		}
+	}
+
+	/*!
+	 * @brief 生成并发送一条信息
+	 */
+	void send(Peer* peer, int type) {
+		const char* s(NULL);
+		int n(0), seq(peer->seq++);
+
+		if (type == LOAD_REGISTER) {
+			kvreg proto = boost::make_shared<kv_proto_reg>();
+			proto->gid = peer->gid;
+			proto->uid = peer->uid;
+			s = kvProto_->CompactRegister(proto, n);
+		}
+		else if (type == LOAD_MOUNT) {
+			kvmount proto = boost::make_shared<kv_proto_mount>();
+			proto->gid   = peer->gid;
+			proto->uid   = peer->uid;
+			proto->state = StateMount::MOUNT_TRACKING;
+			proto->ra    = fmod(seq * 0.01, 360.0);
+			proto->dec   = 40.0;
+			proto->azi   = 180.0;
+			proto->alt   = 60.0;
+			s = kvProto_->CompactMount(proto, n);
+		}
+		else if (type == LOAD_NONKV) {
+			char buff[100];
+			if (!seq) n = sprintf(buff, "g#%s%s%s%d%%\n", peer->gid.c_str(), peer->uid.c_str(), NONKVTYPE_STATE,
+					StateMount::MOUNT_TRACKING);
+			else n = sprintf(buff, "g#%s%s%s%07d%%%+07d%%\n", peer->gid.c_str(), peer->uid.c_str(), NONKVTYPE_MOUNT,
+					(seq * 100) % 3600000, 400000);
+			s = buff;
+			count(peer->client->Write(s, n), n, type);
+			return;
+		}
+		else if (type == LOAD_CAMERA) {
+			kvcamera proto = boost::make_shared<kv_proto_camera>();
+			proto->gid     = peer->gid;
+			proto->uid     = peer->uid;
+			proto->cid     = peer->cid;
+			proto->state   = StateCameraControl::CAMCTL_IDLE;
+			proto->coolget = -40;
+			s = kvProto_->CompactCamera(proto, n);
+		}
+		else if (type == LOAD_SLIT && peer->nonkv) {
+			char buff[100];
+			n = sprintf(buff, "g#%s%s%s%d%%\n", peer->gid.c_str(), peer->uid.c_str(), NONKVTYPE_SLIT,
+					StateSlit::SLIT_OPENED);
+			s = buff;
+			count(peer->client->Write(s, n), n, type);
+			return;
+		}
+		else if (type == LOAD_RAIN) {
+			char buff[100];
+			peer->rain = peer->rain == 0 ? 1 : 0;
+			n = sprintf(buff, "g#%s%s%d%%\n", peer->gid.c_str(), NONKVTYPE_RAIN, peer->rain);
+			s = buff;
+			if (peer->rain) {
+				MtxLck lck(peer->mtx);
+				peer->pending.push_back(SteadyClock::now());
+			}
+			count(peer->client->Write(s, n), n, type);
+			return;
+		}
+		else if (type == LOAD_SLIT) {
+			kvslit proto = boost::make_shared<kv_proto_slit>();
+			proto->gid   = peer->gid;
+			proto->uid   = peer->uid;
+			proto->state = StateSlit::SLIT_OPENED;
+			s = kvProto_->CompactSlit(proto, n);
+		}
+		else if (type == LOAD_FILEINFO) {
+			kvfileinfo proto = boost::make_shared<kv_proto_fileinfo>();
+			char name[100];
+			sprintf(name, "G%s%s%s_%06d.fit", peer->gid.c_str(), peer->uid.c_str(), peer->cid.c_str(), seq);
+			proto->gid      = peer->gid;
+			proto->uid      = peer->uid;
+			proto->cid      = peer->cid;
+			proto->grid     = "loadgen";
+			proto->field    = "0000";
+			proto->tmobs    = to_iso_extended_string(microsec_clock::universal_time());
+			proto->subpath  = "loadgen";
+			proto->filename = name;
+			proto->filesize = 18878400;
+			s = kvProto_->CompactFileInfo(proto, n);
+		}
+		else if (type == LOAD_CHECKPLAN) {
+			char plan_sn[40];
+			sprintf(plan_sn, "Q%s%s%06d", peer->gid.c_str(), peer->uid.c_str(), seq);
+			s = kvProto_->CompactCheckPlan(plan_sn, n);
+			MtxLck lck(peer->mtx);
+			peer->pending.push_back(SteadyClock::now());
+		}
+		else if (type == LOAD_APPENDPLAN) {
+			ObsPlanItemPtr plan = ObservationPlanItem::Create();
+			char plan_sn[40];
+			sprintf(plan_sn, "L%s%s%08d", peer->gid.c_str(), peer->uid.c_str(), seq);
+			plan->gid     = peer->gid;
+			plan->uid     = peer->uid;
+			plan->plan_sn = plan_sn;
+			plan->objname = "loadgen";
+			plan->lon     = fmod(seq * 0.1, 360.0);
+			plan->lat     = 40.0;
+			plan->imgtype = TypeImage::ToString(TypeImage::IMGTYP_BIAS);
+			plan->expdur  = 1.0;
+			plan->frmcnt  = 1;
+			s = kvProto_->CompactAppendPlan(plan, n);
+		}
+		// 协议封装使用共享缓冲区, Write()拷贝后即可复用
+		count(peer->client->Write(s, n), n, type);
+	}
+
+	void count(int sent, int n, int type) {
+		if (!sent) ++dropped_;
+		else {
+			++msgSent_[type];
+			bytesSent_ += n;
+		}
+	}
+
+	static uint32_t percentile(const LatVec& lat, double q) {
+		if (lat.empty()) return 0;
+		size_t i = size_t(q * (lat.size() - 1) + 0.5);
+		return lat[i];
+	}
+
+	/*!
+	 * @brief 每秒输出一次吞吐量与时延, 直至到达运行时长
+	 */
+	void report_progress(SteadyClock::time_point start) {
+		uint64_t lastSent(0), lastBytes(0), lastReplies(0);
+		LatVec lat;
+
+		for (int t = 1; t <= opt_.duration; ++t) {
+			boost::this_thread::sleep_until(start + boost::chrono::seconds(t));
+			uint64_t sent(0), bytes(bytesSent_), replies(replies_);
+			for (int i = 0; i < LOAD_LAST; ++i) sent += msgSent_[i];
+			{
+				MtxLck lck(mtx_lat_);
+				lat.swap(latWindow_);
+				latWindow_.clear();
+			}
+			std::sort(lat.begin(), lat.end());
+			printf("%4d s: %6d online, %8.0f msg/s, %8.1f KB/s, %6.0f reply/s, rtt p50 %.3f p99 %.3f ms\n",
+					t, connected_.load(), double(sent - lastSent), (bytes - lastBytes) / 1024.0,
+					double(replies - lastReplies),
+					percentile(lat, 0.5) * 1E-3, percentile(lat, 0.99) * 1E-3);
+			fflush(stdout);
+			lastSent    = sent;
+			lastBytes   = bytes;
+			lastReplies = replies;
+		}
+	}
+
+	void report_summary(SteadyClock::duration elapsed) {
+		double secs = boost::chrono::duration<double>(elapsed).count();
+		uint64_t sent(0);
+		int i;
+
+		printf("\n---------------- summary: %.1f s ----------------\n", secs);
+		for (i = 0; i < LOAD_LAST; ++i) {
+			if (!msgSent_[i]) continue;
+			sent += msgSent_[i];
+			printf("%-14s %10llu msg  %10.1f msg/s\n", load_desc[i],
+					(unsigned long long) msgSent_[i].load(), msgSent_[i] / secs);
+		}
+		printf("%-14s %10llu msg  %10.1f msg/s  %.1f KB/s\n", "total sent",
+				(unsigned long long) sent, sent / secs, bytesSent_ / secs / 1024.0);
+		printf("%-14s %10llu msg  %10.1f msg/s\n", "replies",
+				(unsigned long long) replies_.load(), replies_ / secs);
+		printf("%-14s %10llu msg  %10.1f KB received\n", "pushed",
+				(unsigned long long) pushed_.load(), bytesRecv_ / 1024.0);
+
+		MtxLck lck(mtx_lat_);
+		std::sort(latTotal_.begin(), latTotal_.end());
+		if (latTotal_.size()) {
+			printf("rtt(ms)        p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f\n",
+					percentile(latTotal_, 0.5) * 1E-3, percentile(latTotal_, 0.9) * 1E-3,
+					percentile(latTotal_, 0.99) * 1E-3, percentile(latTotal_, 0.999) * 1E-3,
+					latTotal_.back() * 1E-3);
+		}
+		uint64_t unanswered(0), alarmMissed(0);
+		for (PeerVec::iterator it = peers_.begin(); it != peers_.end(); ++it) {
+			MtxLck lck((*it)->mtx);
+			if ((*it)->IsWeather()) alarmMissed += (*it)->pending.size();
+			else unanswered += (*it)->pending.size();
+		}
+		if (opt_.rainPeriod > 0) {
+			std::sort(latAlarm_.begin(), latAlarm_.end());
+			printf("rain->slit(ms) p50 %.3f  max %.3f  closed %d, missed %llu\n",
+					percentile(latAlarm_, 0.5) * 1E-3, latAlarm_.size() ? latAlarm_.back() * 1E-3 : 0.0,
+					int(latAlarm_.size()), (unsigned long long) alarmMissed);
+		}
+		printf("errors         connect failed %d, closed by server %d, dropped %llu, unanswered %llu\n",
+				connFail_.load(), closedByServer_.load(),
+				(unsigned long long) dropped_.load(), (unsigned long long) unanswered);
+	}
+};
+
+static void usage() {
+	printf("Usage: gtoaes-loadgen [options]\n"
+			"  -H host      server address, default 127.0.0.1\n"
+			"  -p port      client port; device ports follow it, default 4010\n"
+			"  -G gid       group id, default 001\n"
+			"  -m n         kv mounts, default 10\n"
+			"  -w n         non-kv (GWAC) mounts, default 0\n"
+			"  -c n         cameras, default 0\n"
+			"  -a n         mount annexes, default 0\n"
+			"  -f n         camera annexes sending fileinfo, default 0\n"
+			"  -u n         clients, default 10\n"
+			"  -r hz        device status rate per connection, default 1\n"
+			"  -q hz        check_plan rate per client, default 1\n"
+			"  -b n         append_plan burst size per client, default 0\n"
+			"  -B sec       append_plan burst period, default 10\n"
+			"  -t sec       duration, default 30\n"
+			"  -n n         network I/O threads, default 1\n"
+			"  -R sec       simulate a non-kv weather station: raise a rain alarm every sec seconds,\n"
+			"               clear it half a period later. needs Dome Slit and Rainfall enabled. default 0\n");
+}
+
+int main(int argc, char **argv) {
+	LoadOption opt;
+	int ch;
+
+	while ((ch = getopt(argc, argv, "H:p:G:m:w:c:a:f:u:r:q:b:B:t:n:R:h")) != -1) {
+		switch (ch) {
+		case 'H': opt.host        = optarg;       break;
+		case 'p': opt.port        = atoi(optarg); break;
+		case 'G': opt.gid         = optarg;       break;
+		case 'm': opt.mounts      = atoi(optarg); break;
+		case 'w': opt.nonkv       = atoi(optarg); break;
+		case 'c': opt.cameras     = atoi(optarg); break;
+		case 'a': opt.mountAnnex  = atoi(optarg); break;
+		case 'f': opt.cameraAnnex = atoi(optarg); break;
+		case 'u': opt.clients     = atoi(optarg); break;
+		case 'r': opt.rateStatus  = atof(optarg); break;
+		case 'q': opt.rateClient  = atof(optarg); break;
+		case 'b': opt.burst       = atoi(optarg); break;
+		case 'B': opt.burstPeriod = atoi(optarg); break;
+		case 't': opt.duration    = atoi(optarg); break;
+		case 'n': opt.ioThreads   = atoi(optarg); break;
+		case 'R': opt.rainPeriod  = atoi(optarg); break;
+		default:  usage();                        return 1;
+		}
+	}
+	if (opt.burstPeriod < 1) opt.burstPeriod = 1;
+
+	signal(SIGPIPE, SIG_IGN);
+	srand(getpid());
+	AsioIOServicePool::Instance().Start(opt.ioThreads);
+	LoadGenerator gen(opt);
+	gen.Run();
+	AsioIOServicePool::Instance().Stop();	// 先停止I/O线程, 再释放连接
+	return 0;
+}